@@ -35,10 +35,18 @@ bool hartebeest_create_local_pd(const char* pd_key) {
     return HARTEBEEST_CORE_HDL.create_local_pd(pd_key);
 }
 
+bool hartebeest_create_local_pd_td(const char* pd_key) {
+    return HARTEBEEST_CORE_HDL.create_local_pd_td(pd_key);
+}
+
 bool hartebeest_create_local_mr(const char* pd_key, const char* mr_key, size_t buflen, int rights) {
     return HARTEBEEST_CORE_HDL.create_local_mr(pd_key, mr_key, buflen, rights);
 }
 
+bool hartebeest_create_local_mr_parallel(const char* pd_key, const char* mr_key, size_t buflen, int rights, int n_threads, size_t chunk_len) {
+    return HARTEBEEST_CORE_HDL.create_local_mr_parallel(pd_key, mr_key, buflen, rights, n_threads, chunk_len);
+}
+
 bool hartebeest_memc_push_local_mr(const char* memc_key, const char* pd_key, const char* mr_key) {
     return HARTEBEEST_CORE_HDL.memc_push_local_mr(memc_key, pd_key, mr_key);
 }
@@ -47,14 +55,61 @@ bool hartebeest_memc_fetch_remote_mr(const char* remote_mr_key) {
     return HARTEBEEST_CORE_HDL.memc_fetch_remote_mr(remote_mr_key);
 }
 
+bool hartebeest_memc_fetch_remote_mr_from(const char* remote_mr_key, int owner) {
+    return HARTEBEEST_CORE_HDL.memc_fetch_remote_mr(remote_mr_key, owner);
+}
+
+bool hartebeest_create_local_mw(const char* pd_key, const char* mw_key) {
+    return HARTEBEEST_CORE_HDL.create_local_mw(pd_key, mw_key);
+}
+
+bool hartebeest_bind_local_mw(const char* pd_key, const char* qp_key, const char* mr_key, const char* mw_key, size_t offset, size_t len, int rights) {
+    return HARTEBEEST_CORE_HDL.bind_local_mw(pd_key, qp_key, mr_key, mw_key, offset, len, rights);
+}
+
+bool hartebeest_invalidate_local_mw(const char* pd_key, const char* qp_key, const char* mw_key) {
+    return HARTEBEEST_CORE_HDL.invalidate_local_mw(pd_key, qp_key, mw_key);
+}
+
+bool hartebeest_memc_push_local_mw(const char* memc_key, const char* pd_key, const char* mw_key) {
+    return HARTEBEEST_CORE_HDL.memc_push_local_mw(memc_key, pd_key, mw_key);
+}
+
+bool hartebeest_open_local_xrcd(const char* path) {
+    return HARTEBEEST_CORE_HDL.open_local_xrcd(path);
+}
+
+bool hartebeest_create_local_xrc_srq(const char* pd_key, const char* srq_key, const char* cq_key) {
+    return HARTEBEEST_CORE_HDL.create_local_xrc_srq(pd_key, srq_key, cq_key);
+}
+
+bool hartebeest_memc_push_local_xrc_srq(const char* memc_key, const char* pd_key, const char* srq_key) {
+    return HARTEBEEST_CORE_HDL.memc_push_local_xrc_srq(memc_key, pd_key, srq_key);
+}
+
+uint32_t hartebeest_memc_fetch_remote_srqn(const char* remote_srq_key) {
+    return HARTEBEEST_CORE_HDL.memc_fetch_remote_srqn(remote_srq_key);
+}
+
 bool hartebeest_create_basiccq(const char* cq_key) {
     return HARTEBEEST_CORE_HDL.create_basiccq(cq_key);
 }
 
+bool hartebeest_create_basiccq_td(const char* cq_key, const char* pd_key) {
+    return HARTEBEEST_CORE_HDL.create_basiccq_td(cq_key, pd_key);
+}
+
 bool hartebeest_create_local_qp(const char* pd_key,const char* qp_key, enum ibv_qp_type conn, const char* sendcq_key, const char* recvcq_key) {
     return HARTEBEEST_CORE_HDL.create_local_qp(pd_key, qp_key, conn, sendcq_key, recvcq_key);
 }
 
+bool hartebeest_create_local_qp_profile(
+        const char* pd_key, const char* qp_key, enum ibv_qp_type conn, 
+        const char* sendcq_key, const char* recvcq_key, const char* profile
+    ) {
+    return HARTEBEEST_CORE_HDL.create_local_qp(pd_key, qp_key, conn, sendcq_key, recvcq_key, profile);
+}
+
 bool hartebeest_init_local_qp(const char* pd_key, const char* qp_key) {
     return HARTEBEEST_CORE_HDL.init_local_qp(pd_key, qp_key);
 }
@@ -63,20 +118,101 @@ bool hartebeest_connect_local_qp(const char* pd_key, const char* local_qp_key, c
     return HARTEBEEST_CORE_HDL.connect_local_qp(pd_key, local_qp_key, remote_qp_key);
 }
 
+bool hartebeest_create_local_qp_pool(const char* pd_key, int n_qps, enum ibv_qp_type conn, const char* sendcq_key, const char* recvcq_key) {
+    return HARTEBEEST_CORE_HDL.create_local_qp_pool(pd_key, n_qps, conn, sendcq_key, recvcq_key);
+}
+
+bool hartebeest_acquire_local_qp(const char* pd_key, const char* qp_key) {
+    return HARTEBEEST_CORE_HDL.acquire_local_qp(pd_key, qp_key);
+}
+
+bool hartebeest_release_local_qp(const char* pd_key, const char* qp_key) {
+    return HARTEBEEST_CORE_HDL.release_local_qp(pd_key, qp_key);
+}
+
 bool hartebeest_memc_push_local_qp(const char* memc_key, const char* pd_key, const char* qp_key) {
     return HARTEBEEST_CORE_HDL.memc_push_local_qp(memc_key, pd_key, qp_key);
 }
 
+bool hartebeest_ready_local_ud_qp(const char* pd_key, const char* qp_key) {
+    return HARTEBEEST_CORE_HDL.ready_local_ud_qp(pd_key, qp_key);
+}
+
+struct ibv_ah* hartebeest_get_remote_ah(const char* pd_key, const char* remote_qp_key) {
+    return HARTEBEEST_CORE_HDL.get_remote_ah(pd_key, remote_qp_key);
+}
+
 bool hartebeest_memc_fetch_remote_qp(const char* remote_qp_key) {
     return HARTEBEEST_CORE_HDL.memc_fetch_remote_qp(remote_qp_key);
 }
 
+bool hartebeest_add_rail(int idx, uint8_t port_num) {
+    return HARTEBEEST_CORE_HDL.add_rail(idx, port_num);
+}
+
+bool hartebeest_create_rail_set(const char* set_key, size_t buflen, int rights, enum ibv_qp_type conn) {
+    return HARTEBEEST_CORE_HDL.create_rail_set(set_key, buflen, rights, conn);
+}
+
+bool hartebeest_memc_push_rail_set(const char* memc_prefix, const char* set_key) {
+    return HARTEBEEST_CORE_HDL.memc_push_rail_set(memc_prefix, set_key);
+}
+
+bool hartebeest_connect_rail_set(const char* set_key, const char* remote_memc_prefix) {
+    return HARTEBEEST_CORE_HDL.connect_rail_set(set_key, remote_memc_prefix);
+}
+
+bool hartebeest_connect_all(const char* pd_key, const char* mr_key, const char* cq_key, int topology) {
+    return HARTEBEEST_CORE_HDL.connect_all(pd_key, mr_key, cq_key, topology);
+}
+
+bool hartebeest_create_meta_plane(const char* pd_key) {
+    return HARTEBEEST_CORE_HDL.create_meta_plane(pd_key);
+}
+
+bool hartebeest_arm_rdma_barrier(const char* pd_key, const char* mr_key, size_t offset) {
+    return HARTEBEEST_CORE_HDL.arm_rdma_barrier(pd_key, mr_key, offset);
+}
+
+bool hartebeest_barrier(const char* key) {
+    return HARTEBEEST_CORE_HDL.barrier(key);
+}
+
+bool hartebeest_create_rdma_directory(const char* pd_key, size_t n_entries) {
+    return HARTEBEEST_CORE_HDL.create_rdma_directory(pd_key, n_entries);
+}
+
+bool hartebeest_arm_rdma_directory(const char* pd_key) {
+    return HARTEBEEST_CORE_HDL.arm_rdma_directory(pd_key);
+}
+
+bool hartebeest_rdma_write_striped(const char* set_key, size_t offset, size_t len, size_t stripe_len, int window) {
+    return HARTEBEEST_CORE_HDL.rdma_write_striped(set_key, offset, len, stripe_len, window);
+}
+
 bool hartebeest_rdma_post_single_fast(
         struct ibv_qp* local_qp, void* local_addr, void* remote_addr, size_t len, 
         enum ibv_wr_opcode opcode, uint32_t lkey, uint32_t rkey, uint64_t work_id) {
     return HARTEBEEST_CORE_HDL.rdma_post_single_fast(local_qp, local_addr, remote_addr, len, opcode, lkey, rkey, work_id);
 }
 
+bool hartebeest_rdma_post_ud_send(
+        struct ibv_qp* local_qp, struct ibv_ah* remote_ah, uint32_t remote_qpn, uint32_t remote_qkey, 
+        void* local_addr, size_t len, uint32_t lkey, uint64_t work_id) {
+    return HARTEBEEST_CORE_HDL.rdma_post_ud_send(local_qp, remote_ah, remote_qpn, remote_qkey, local_addr, len, lkey, work_id);
+}
+
+bool hartebeest_rdma_post_ud_recv(
+        struct ibv_qp* local_qp, void* recv_slot, size_t len, uint32_t lkey, uint64_t work_id) {
+    return HARTEBEEST_CORE_HDL.rdma_post_ud_recv(local_qp, recv_slot, len, lkey, work_id);
+}
+
+bool hartebeest_rdma_post_single_xrc(
+        struct ibv_qp* local_qp, void* local_addr, void* remote_addr, size_t len, 
+        enum ibv_wr_opcode opcode, uint32_t lkey, uint32_t rkey, uint32_t remote_srqn, uint64_t work_id) {
+    return HARTEBEEST_CORE_HDL.rdma_post_single_xrc(local_qp, local_addr, remote_addr, len, opcode, lkey, rkey, remote_srqn, work_id);
+}
+
 bool hartebeest_rdma_post_single_signaled_inline(
         struct ibv_qp* local_qp, void* local_addr, void* remote_addr, size_t len, 
         enum ibv_wr_opcode opcode, uint32_t lkey, uint32_t rkey, uint64_t work_id) {
@@ -103,10 +239,30 @@ struct ibv_mr* hartebeest_get_local_mr(const char* pd_key, const char* mr_key) {
     return HARTEBEEST_CORE_HDL.get_local_mr(pd_key, mr_key)->get_mr();
 }
 
+struct ibv_mw* hartebeest_get_local_mw(const char* pd_key, const char* mw_key) {
+    return HARTEBEEST_CORE_HDL.get_local_mw(pd_key, mw_key)->get_mw();
+}
+
+struct ibv_srq* hartebeest_get_local_xrc_srq(const char* pd_key, const char* srq_key) {
+    return HARTEBEEST_CORE_HDL.get_local_xrc_srq(pd_key, srq_key)->get_srq();
+}
+
+struct ibv_cq* hartebeest_get_local_basiccq(const char* cq_key) {
+    return HARTEBEEST_CORE_HDL.get_local_basiccq(cq_key)->get_cq();
+}
+
+void hartebeest_report_basiccq_usage(const char* cq_key) {
+    HARTEBEEST_CORE_HDL.get_local_basiccq(cq_key)->report_usage();
+}
+
 struct ibv_qp* hartebeest_get_local_qp(const char* pd_key, const char* qp_key) {
     return HARTEBEEST_CORE_HDL.get_local_qp(pd_key, qp_key)->get_qp();
 }
 
+uint32_t hartebeest_get_local_qp_qkey(const char* pd_key, const char* qp_key) {
+    return HARTEBEEST_CORE_HDL.get_local_qp(pd_key, qp_key)->get_qkey();
+}
+
 struct ibv_mr* hartebeest_get_remote_mr(const char* remote_mr_key) {
     return HARTEBEEST_CORE_HDL.get_remote_mr(remote_mr_key)->get_mr();
 }
@@ -115,6 +271,14 @@ struct ibv_qp* hartebeest_get_remote_qp(const char* remote_qp_key) {
     return HARTEBEEST_CORE_HDL.get_remote_qp(remote_qp_key)->get_qp();
 }
 
+struct ibv_qp* hartebeest_get_peer_qp(const char* pd_key, int peer) {
+    return HARTEBEEST_CORE_HDL.get_peer_qp(pd_key, peer)->get_qp();
+}
+
+struct ibv_mr* hartebeest_get_peer_mr(const char* pd_key, const char* mr_key, int peer) {
+    return HARTEBEEST_CORE_HDL.get_peer_mr(pd_key, mr_key, peer)->get_mr();
+}
+
 
 
 
@@ -5,9 +5,128 @@
 
 #include <unistd.h>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <map>
 
 #include "./includes/hartebeest.hh"
 
+namespace hartebeest {
+
+    // Records may grow in later versions, never shrink.
+    bool is_valid_wire_mr(const WireRecord* rec) {
+        if (rec == nullptr || rec->kind != WIRE_KIND_MR || rec->rec_len < sizeof(WireMr))
+            return false;
+
+        const WireMr* mr_rec = reinterpret_cast<const WireMr*>(rec);
+        return (rec->rec_len >= sizeof(WireMr) + mr_rec->n_chunks * sizeof(uint32_t));
+    }
+
+    bool is_valid_wire_qp(const WireRecord* rec) {
+        return (rec != nullptr && rec->kind == WIRE_KIND_QP && rec->rec_len >= sizeof(WireQp));
+    }
+
+    // Several bundles in one value: for each, key length, key, value length, value.
+    std::string pack_bundles(const std::map<std::string, std::string>& bundles) {
+        std::string packed;
+
+        for (auto& bundle: bundles) {
+            uint32_t lens[2] = { 
+                static_cast<uint32_t>(bundle.first.size()), static_cast<uint32_t>(bundle.second.size()) };
+
+            packed.append(reinterpret_cast<const char*>(&lens[0]), sizeof(uint32_t));
+            packed.append(bundle.first);
+            packed.append(reinterpret_cast<const char*>(&lens[1]), sizeof(uint32_t));
+            packed.append(bundle.second);
+        }
+
+        return packed;
+    }
+
+    bool unpack_bundles(const std::string& packed, std::map<std::string, std::string>& bundles) {
+        size_t offset = 0;
+
+        while (offset < packed.size()) {
+            std::string fields[2];
+
+            for (auto& field: fields) {
+                uint32_t len;
+                if (offset + sizeof(len) > packed.size())
+                    return false;
+
+                std::memcpy(&len, packed.data() + offset, sizeof(len));
+                offset += sizeof(len);
+
+                if (offset + len > packed.size())
+                    return false;
+
+                field.assign(packed.data() + offset, len);
+                offset += len;
+            }
+
+            bundles[fields[0]] = fields[1];
+        }
+
+        return true;
+    }
+
+    // Keeps MRs, and the QPs "<...>-<dst>" whose dst passes.
+    std::string filter_bundle(const std::string& bundle, const std::function<bool(int)>& is_dst) {
+        WireReader reader(bundle);
+        WireWriter writer;
+
+        const WireRecord* rec;
+        while ((rec = reader.next()) != nullptr) {
+            if (rec->kind == WIRE_KIND_QP) {
+                std::string name = wire_name(rec);
+                size_t dash = name.rfind('-');
+
+                if (dash != std::string::npos && dash + 1 < name.size() &&
+                    std::isdigit(name[dash + 1]) && !is_dst(std::stoi(name.substr(dash + 1))))
+                    continue;
+            }
+
+            uint8_t* copy = reinterpret_cast<uint8_t*>(
+                writer.append(static_cast<enum WireKind>(rec->kind), wire_name(rec).c_str(), rec->rec_len));
+            std::memcpy(copy + sizeof(WireRecord), 
+                reinterpret_cast<const uint8_t*>(rec) + sizeof(WireRecord), rec->rec_len - sizeof(WireRecord));
+        }
+
+        return writer.finish();
+    }
+
+    // Runs fn(0..n_items-1) over at most n_threads workers.
+    void parallel_for(size_t n_items, int n_threads, const std::function<void(size_t)>& fn) {
+        
+        if (n_threads <= 1 || n_items <= 1) {
+            for (size_t idx = 0; idx < n_items; idx++)
+                fn(idx);
+            return;
+        }
+
+        std::atomic<size_t> next_item(0);
+        std::vector<std::thread> workers;
+
+        for (int t = 0; t < n_threads && static_cast<size_t>(t) < n_items; t++) {
+            workers.push_back(std::thread([&]() {
+                size_t idx;
+                while ((idx = next_item++) < n_items)
+                    fn(idx);
+            }));
+        }
+
+        for (auto& worker: workers)
+            worker.join();
+    }
+}
+
 hartebeest::HartebeestCore::HartebeestCore(int idx, uint8_t port_num) : hca_idx(idx) {
 
     hb_retcode hb_rc = HB_CFG_LOADER.init_sysvars();
@@ -15,230 +134,1827 @@ hartebeest::HartebeestCore::HartebeestCore(int idx, uint8_t port_num) : hca_idx(
 
     nid = std::stoi(HB_CFG_LOADER.get_sysvar("HARTEBEEST_NID"));
 
-    int n_hca = HB_HCA_INITR.get_n_hca_devs();
+    int n_hca = HB_HCA_INITR.get_n_hca_devs();
+
+    assert(n_hca > 0);
+    hb_rc = HB_HCA_INITR.open_device(idx);
+    HB_CLOGGER->info("{}", hb_rc.aux_str);
+
+    hb_rc = HB_HCA_INITR.bind_port(idx, port_num);
+    HB_CLOGGER->info("{}", hb_rc.aux_str);
+
+    hartebeest::HcaPort rail_port;
+    if (HB_HCA_INITR.query_port(idx, port_num, rail_port).ret_code == HCAINITR_RETCODE_BIND_PORT_OK)
+        rails.push_back(rail_port);
+}
+
+hartebeest::HartebeestCore::~HartebeestCore() {    
+    delete rdma_dir.local;
+    HB_CLOGGER->info("Hartebeest core end");
+}
+
+bool hartebeest::HartebeestCore::memc_push_general(const char* msg_key) {
+
+    const char* empty_str = "  ";
+    hb_retcode hb_rc;
+    hb_rc = HARTEBEEST_MEMC_HDL.set(msg_key, empty_str);
+
+    if (hb_rc.ret_code == MEMCH_SET_OK)
+        return true;
+    
+    return false;
+}
+
+bool hartebeest::HartebeestCore::memc_wait_general(const char* msg_key) {
+
+    std::string fetched;
+    HB_CLOGGER->info("Message wait: {}", msg_key);
+
+    if (HARTEBEEST_MEMC_HDL.wait_get(msg_key, fetched).ret_code != MEMCH_GET_OK) {
+        HB_CLOGGER->warn("Message fetch timeout: {}", msg_key);
+        return false;
+    }
+    
+    HB_CLOGGER->info("Message detected: {}", msg_key);
+    return true;
+}
+
+bool hartebeest::HartebeestCore::memc_del_general(const char* msg_key) {
+    hb_retcode hb_rc;
+    hb_rc = HARTEBEEST_MEMC_HDL.del(msg_key);
+
+    if (hb_rc.ret_code == MEMCH_DEL_OK)
+        return true;
+    
+    return false;
+}
+
+void hartebeest::HartebeestCore::init() {
+    // Does nothing, but for the call the get_instance().
+    if (1)
+        ;
+}
+
+bool hartebeest::HartebeestCore::create_local_pd(const char* pd_key) {
+    hartebeest::Pd* new_pd = new hartebeest::Pd(
+        pd_key, HB_HCA_INITR.get_hca(hca_idx)
+    );
+    hb_retcode hb_rc = HB_PD_CACHE.register_resrc(pd_key, new_pd);
+    HB_CLOGGER->info("New protection domain {}: {}", pd_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == CACHE_RETCODE_REGISTER_OK)
+        return true;
+
+    return false;
+}
+
+// Thread-bound PD. QPs created under it skip the provider's locks, so only
+// one thread may post to them at a time.
+bool hartebeest::HartebeestCore::create_local_pd_td(const char* pd_key) {
+    if (!create_local_pd(pd_key))
+        return false;
+
+    hb_retcode hb_rc = HB_PD_CACHE.get_resrc(pd_key)->bind_thread_domain();
+    HB_CLOGGER->info("Thread domain for {}: {}", pd_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == PD_RETCODE_ALLOC_TD_OK)
+        return true;
+
+    return false;
+}
+
+bool hartebeest::HartebeestCore::create_local_mr(const char* pd_key, const char* mr_key, size_t buflen, int rights) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    hb_retcode hb_rc = registered_pd->create_mr(mr_key, buflen, rights);
+    HB_CLOGGER->info("New memory region {}, to {}: {}", mr_key, pd_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == PD_RETCODE_CREATE_MR_OK)
+        return true;
+    
+    return false;
+}
+
+bool hartebeest::HartebeestCore::create_local_mr_parallel(
+        const char* pd_key, const char* mr_key, size_t buflen, int rights, int n_threads, size_t chunk_len
+    ) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    hb_retcode hb_rc = registered_pd->create_mr_parallel(mr_key, buflen, rights, n_threads, chunk_len);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    HB_CLOGGER->info("New memory region {}, to {} ({} ms): {}", mr_key, pd_key, elapsed, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == PD_RETCODE_CREATE_MR_OK)
+        return true;
+    
+    return false;
+}
+
+bool hartebeest::HartebeestCore::memc_push_local_mr(const char* memc_key, const char* pd_key, const char* mr_key) {
+
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    hartebeest::Mr* local_mr = local_pd->get_mr_cache().get_resrc(mr_key);
+
+    std::string record = encode_mr(local_mr);
+
+    // The exchanger only gets what the directory could not take.
+    if (rdma_dir.armed && rdma_dir_publish(memc_key, record))
+        return true;
+
+    hb_retcode hb_rc;
+    hb_rc = HARTEBEEST_MEMC_HDL.set(memc_key, record);
+
+    if (hb_rc.ret_code == MEMCH_SET_OK)
+        return true;
+    
+    return false;
+}
+
+// With the RDMA directory armed, pass the node id that pushed the MR: its
+// directory is read first, then the exchanger, until either has the record.
+bool hartebeest::HartebeestCore::memc_fetch_remote_mr(const char* remote_mr_key, int owner) {
+    std::string fetched{""};
+
+    if (rdma_dir.armed && owner >= 0) {
+        hartebeest::Backoff deadline;
+
+        while (!rdma_dir_lookup(owner, remote_mr_key, fetched, deadline) &&
+            HARTEBEEST_MEMC_HDL.get(remote_mr_key, fetched).ret_code != MEMCH_GET_OK) {
+
+            if (deadline.expired()) {
+                HB_CLOGGER->warn("Fetch MEMC: {} of node {} did not show up", remote_mr_key, owner);
+                return false;
+            }
+            deadline.wait();
+        }
+    }
+
+    else if (HARTEBEEST_MEMC_HDL.wait_get(remote_mr_key, fetched).ret_code != MEMCH_GET_OK)
+        return false;
+
+    hartebeest::Mr* remote_mr = register_remote_mr(remote_mr_key, fetched);
+    if (remote_mr == nullptr)
+        return false;
+
+    HB_CLOGGER->info("Fetch MEMC: {}, 0x{:x}", remote_mr_key, uintptr_t(remote_mr));
+
+    return true;
+}
+
+bool hartebeest::HartebeestCore::memc_fetch_remote_mrs(const std::vector<std::string>& remote_mr_keys) {
+    bool all_fetched = memc_fetch_bulk(remote_mr_keys, [&](const std::string& key, const std::string& fetched) {
+        register_remote_mr(key.c_str(), fetched);
+    });
+
+    HB_CLOGGER->info("Fetch MEMC: {} remote MRs", remote_mr_keys.size());
+    return all_fetched;
+}
+
+hartebeest::Mr* hartebeest::HartebeestCore::register_remote_mr(const char* remote_mr_key, const std::string& fetched) {
+    hartebeest::Mr* remote_mr = decode_mr(remote_mr_key, fetched);
+    if (remote_mr == nullptr)
+        return nullptr;
+
+    remote_mr_cache.register_resrc(remote_mr_key, remote_mr);
+
+    return remote_mr;
+}
+
+bool hartebeest::HartebeestCore::create_local_mw(const char* pd_key, const char* mw_key) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    hb_retcode hb_rc = registered_pd->create_mw(mw_key);
+    HB_CLOGGER->info("New memory window {}, to {}: {}", mw_key, pd_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == PD_RETCODE_CREATE_MW_OK)
+        return true;
+    
+    return false;
+}
+
+bool hartebeest::HartebeestCore::bind_local_mw(
+        const char* pd_key, const char* qp_key, const char* mr_key, const char* mw_key, 
+        size_t offset, size_t len, int rights
+    ) {
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(local_pd != nullptr);
+
+    hartebeest::Qp* local_qp = local_pd->get_qp_cache().get_resrc(qp_key);
+    hartebeest::Mr* local_mr = local_pd->get_mr_cache().get_resrc(mr_key);
+    hartebeest::Mw* local_mw = local_pd->get_mw_cache().get_resrc(mw_key);
+
+    assert((local_qp != nullptr) && (local_mr != nullptr) && (local_mw != nullptr));
+
+    hb_retcode hb_rc = local_mw->bind(local_qp->get_qp(), local_mr, offset, len, rights);
+    if (hb_rc.ret_code == MW_BIND_OK)
+        return true;
+
+    HB_CLOGGER->warn("{}", hb_rc.aux_str);
+    return false;
+}
+
+bool hartebeest::HartebeestCore::invalidate_local_mw(const char* pd_key, const char* qp_key, const char* mw_key) {
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(local_pd != nullptr);
+
+    hartebeest::Qp* local_qp = local_pd->get_qp_cache().get_resrc(qp_key);
+    hartebeest::Mw* local_mw = local_pd->get_mw_cache().get_resrc(mw_key);
+
+    assert((local_qp != nullptr) && (local_mw != nullptr));
+
+    hb_retcode hb_rc = local_mw->invalidate(local_qp->get_qp());
+    if (hb_rc.ret_code == MW_INVALIDATE_OK)
+        return true;
+
+    HB_CLOGGER->warn("{}", hb_rc.aux_str);
+    return false;
+}
+
+bool hartebeest::HartebeestCore::memc_push_local_mw(const char* memc_key, const char* pd_key, const char* mw_key) {
+
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    hartebeest::Mw* local_mw = local_pd->get_mw_cache().get_resrc(mw_key);
+
+    if (!local_mw->is_bound()) {
+        HB_CLOGGER->warn("MW({}) not bound, nothing to push", mw_key);
+        return false;
+    }
+
+    hb_retcode hb_rc;
+    hb_rc = HARTEBEEST_MEMC_HDL.set(memc_key, local_mw->flatten_info().c_str());
+
+    if (hb_rc.ret_code == MEMCH_SET_OK)
+        return true;
+    
+    return false;
+}
+
+bool hartebeest::HartebeestCore::open_local_xrcd(const char* path) {
+    hb_retcode hb_rc = HB_HCA_INITR.get_hca(hca_idx).xrcd_open(path);
+    HB_CLOGGER->info("XRC domain open ({}): {}", (path != nullptr) ? path : "private", hb_rc.aux_str);
+
+    if (hb_rc.ret_code == HCA_RETCODE_XRCD_OK)
+        return true;
+
+    return false;
+}
+
+bool hartebeest::HartebeestCore::create_local_xrc_srq(const char* pd_key, const char* srq_key, const char* cq_key) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    struct ibv_cq* cq = HB_BASICCQ_CACHE.get_resrc(cq_key)->get_cq();
+    assert(cq != nullptr);
+
+    hb_retcode hb_rc = registered_pd->create_xrc_srq(srq_key, cq);
+    HB_CLOGGER->info("New XRC SRQ {}, to {}: {}", srq_key, pd_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == PD_RETCODE_CREATE_SRQ_OK)
+        return true;
+
+    return false;
+}
+
+bool hartebeest::HartebeestCore::memc_push_local_xrc_srq(const char* memc_key, const char* pd_key, const char* srq_key) {
+
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    hartebeest::XrcSrq* local_srq = local_pd->get_srq_cache().get_resrc(srq_key);
+
+    std::string record;
+    int* binary = HB_CFG_LOADER.get_attr("wire.binary");
+
+    if (binary != nullptr && *binary == 0)
+        record = local_srq->flatten_info();
+    else {
+        hartebeest::WireWriter writer;
+        local_srq->encode_wire(writer);
+        record = writer.finish();
+    }
+
+    hb_retcode hb_rc;
+    hb_rc = HARTEBEEST_MEMC_HDL.set(memc_key, record);
+
+    if (hb_rc.ret_code == MEMCH_SET_OK)
+        return true;
+    
+    return false;
+}
+
+// SRQ numbers are all a sender needs, so they are not cached as containers.
+// Returns 0 if the key never showed up, or its value is malformed.
+uint32_t hartebeest::HartebeestCore::memc_fetch_remote_srqn(const char* remote_srq_key) {
+    std::string fetched;
+
+    if (HARTEBEEST_MEMC_HDL.wait_get(remote_srq_key, fetched).ret_code != MEMCH_GET_OK)
+        return 0;
+
+    uint32_t srqn = 0;
+
+    if (hartebeest::is_wire_format(fetched)) {
+        hartebeest::WireReader reader(fetched);
+        const hartebeest::WireRecord* rec = reader.next();
+
+        if (rec == nullptr || rec->kind != WIRE_KIND_SRQ || rec->rec_len < sizeof(hartebeest::WireSrq)) {
+            HB_CLOGGER->warn("Malformed SRQ record at {}", remote_srq_key);
+            return 0;
+        }
+
+        srqn = reinterpret_cast<const hartebeest::WireSrq*>(rec)->srqn;
+    }
+    else {
+        // Old text: "<name>:<srqn in hex>"
+        size_t colon = fetched.rfind(':');
+        const char* srqn_str = (colon == std::string::npos) ? "" : fetched.c_str() + colon + 1;
+
+        char* end = nullptr;
+        unsigned long parsed = std::strtoul(srqn_str, &end, 16);
+
+        if (end == srqn_str || *end != '\0' || parsed > UINT32_MAX) {
+            HB_CLOGGER->warn("Malformed SRQ value at {}: {}", remote_srq_key, fetched);
+            return 0;
+        }
+
+        srqn = static_cast<uint32_t>(parsed);
+    }
+
+    HB_CLOGGER->info("Fetch MEMC: {}, srqn {:x}", remote_srq_key, srqn);
+    return srqn;
+}
+
+bool hartebeest::HartebeestCore::create_basiccq(const char* cq_key) {
+    hartebeest::BasicCq* new_basiccq = new hartebeest::BasicCq(
+        cq_key, 
+        HB_HCA_INITR.get_hca(hca_idx));
+
+    assert(new_basiccq != nullptr);
+
+    hb_retcode hb_rc;
+    hb_rc = HB_BASICCQ_CACHE.register_resrc(cq_key, new_basiccq);
+    HB_CLOGGER->info("New basic completion queue {}: {}", cq_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == CACHE_RETCODE_REGISTER_OK)
+        return true;
+    
+    return false;
+}
+
+
+bool hartebeest::HartebeestCore::create_basiccq_td(const char* cq_key, const char* pd_key) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    if (!registered_pd->is_thread_bound()) {
+        HB_CLOGGER->warn("{} has no thread domain", pd_key);
+        return false;
+    }
+
+    hartebeest::BasicCq* new_basiccq = new hartebeest::BasicCq(
+        cq_key, 
+        *registered_pd->get_hca(),
+        registered_pd->get_qp_pd());
+
+    if (new_basiccq->get_cq() == nullptr) {
+        HB_CLOGGER->warn("Single-threaded completion queue {} failed", cq_key);
+        delete new_basiccq;
+        return false;
+    }
+
+    hb_retcode hb_rc;
+    hb_rc = HB_BASICCQ_CACHE.register_resrc(cq_key, new_basiccq);
+    HB_CLOGGER->info("New single-threaded completion queue {}: {}", cq_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == CACHE_RETCODE_REGISTER_OK)
+        return true;
+    
+    return false;
+}
+
+// profile picks a named entry of "qp_profiles" in the config, nullptr the defaults.
+bool hartebeest::HartebeestCore::create_local_qp(
+        const char* pd_key, const char* qp_key, enum ibv_qp_type conn_type, 
+        const char* sendcq_key, const char* recvcq_key, const char* profile
+    ) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+
+    assert(registered_pd != nullptr);
+
+    // XRC send QPs take no recv CQ, XRC recv QPs take none. Pass nullptr keys.
+    struct ibv_cq* send_cq = (sendcq_key != nullptr) ? HB_BASICCQ_CACHE.get_resrc(sendcq_key)->get_cq() : nullptr;
+    struct ibv_cq* recv_cq = (recvcq_key != nullptr) ? HB_BASICCQ_CACHE.get_resrc(recvcq_key)->get_cq() : nullptr;
+
+    if ((conn_type != IBV_QPT_XRC_SEND) && (conn_type != IBV_QPT_XRC_RECV))
+        assert((send_cq != nullptr) && (recv_cq != nullptr));
+
+    hb_retcode hb_rc = registered_pd->create_qp(qp_key, conn_type, send_cq, recv_cq, profile);
+    if (hb_rc.ret_code == hartebeest::PD_RETCODE_CREATE_QP_OK)
+        return true;
+
+    return false;
+}
+
+bool hartebeest::HartebeestCore::init_local_qp(const char* pd_key, const char* qp_key) {
+
+    hb_retcode hb_rc = HARTEBEEST_CORE_HDL.get_local_qp(pd_key, qp_key)->transit_init();
+    if (hb_rc.ret_code == QP_TRANSITION_2_INIT_OK)
+        return true;
+    
+    return false;
+}
+
+bool hartebeest::HartebeestCore::create_local_qp_pool(
+        const char* pd_key, int n_qps, enum ibv_qp_type conn_type, const char* sendcq_key, const char* recvcq_key
+    ) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    struct ibv_cq* send_cq = HB_BASICCQ_CACHE.get_resrc(sendcq_key)->get_cq();
+    struct ibv_cq* recv_cq = HB_BASICCQ_CACHE.get_resrc(recvcq_key)->get_cq();
+
+    assert((send_cq != nullptr) && (recv_cq != nullptr));
+
+    hb_retcode hb_rc = registered_pd->create_qp_pool(n_qps, conn_type, send_cq, recv_cq);
+    HB_CLOGGER->info("New QP pool of {}, to {}: {}", n_qps, pd_key, hb_rc.aux_str);
+
+    if (hb_rc.ret_code == hartebeest::PD_RETCODE_QP_POOL_OK)
+        return true;
+
+    return false;
+}
+
+// Replaces create_local_qp() and init_local_qp(). The QP is in INIT already.
+bool hartebeest::HartebeestCore::acquire_local_qp(const char* pd_key, const char* qp_key) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    hb_retcode hb_rc = registered_pd->acquire_qp(qp_key);
+    if (hb_rc.ret_code == hartebeest::PD_RETCODE_QP_POOL_OK)
+        return true;
+
+    return false;
+}
+
+bool hartebeest::HartebeestCore::release_local_qp(const char* pd_key, const char* qp_key) {
+    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(registered_pd != nullptr);
+
+    hb_retcode hb_rc = registered_pd->release_qp(qp_key);
+    if (hb_rc.ret_code == hartebeest::PD_RETCODE_QP_POOL_OK)
+        return true;
+
+    return false;
+}
+
+bool hartebeest::HartebeestCore::connect_local_qp(const char* pd_key, const char* local_qp_key, const char* remote_qp_key) {
+
+    hartebeest::Qp* remote_qp = get_remote_qp(remote_qp_key);
+    hartebeest::Qp* local_qp = get_local_qp(pd_key, local_qp_key);
+
+    assert(remote_qp != nullptr);
+    assert(local_qp != nullptr);
+
+    hb_retcode hb_rc = local_qp->transit_rtr(remote_qp);
+    if (hb_rc.ret_code == QP_TRANSITION_2_RTR_ERR) {
+        HB_CLOGGER->warn("{}", hb_rc.aux_str);
+        return false;
+    }
+
+    // XRC recv QPs only receive, RTR is as far as they go.
+    if (local_qp->get_conn_type() == IBV_QPT_XRC_RECV) {
+        HB_CLOGGER->info("Local QP(State: RTR) {} connected to: {}", local_qp_key, remote_qp_key);
+        return true;
+    }
+
+    hb_rc = local_qp->transit_rts();
+    if (hb_rc.ret_code == QP_TRANSITION_2_RTS_ERR) {
+        HB_CLOGGER->warn("{}", hb_rc.aux_str);
+        return false;
+    }
+
+    HB_CLOGGER->info("Local QP(State: RTS) {} connected to: {}", local_qp_key, remote_qp_key);
+    return true;
+}
+
+// UD QPs have no remote end, so they go to RTR and RTS on their own.
+bool hartebeest::HartebeestCore::ready_local_ud_qp(const char* pd_key, const char* qp_key) {
+
+    hartebeest::Qp* local_qp = get_local_qp(pd_key, qp_key);
+
+    assert(local_qp != nullptr);
+    assert(local_qp->get_conn_type() == IBV_QPT_UD);
+
+    hb_retcode hb_rc = local_qp->transit_rtr(nullptr);
+    if (hb_rc.ret_code == QP_TRANSITION_2_RTR_ERR) {
+        HB_CLOGGER->warn("{}", hb_rc.aux_str);
+        return false;
+    }
+
+    hb_rc = local_qp->transit_rts();
+    if (hb_rc.ret_code == QP_TRANSITION_2_RTS_ERR) {
+        HB_CLOGGER->warn("{}", hb_rc.aux_str);
+        return false;
+    }
+
+    HB_CLOGGER->info("Local UD QP(State: RTS) {} ready", qp_key);
+    return true;
+}
+
+// The fetched remote QP only serves as an address here. Keep the AH, 
+// lookups lock the Pd's cache.
+struct ibv_ah* hartebeest::HartebeestCore::get_remote_ah(const char* pd_key, const char* remote_qp_key) {
+
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    hartebeest::Qp* remote_qp = get_remote_qp(remote_qp_key);
+
+    assert((local_pd != nullptr) && (remote_qp != nullptr));
+
+    hartebeest::Hca* hca_dev = local_pd->get_hca();
+    return local_pd->get_ah_cache().get_ah(
+        local_pd->get_pd(), hca_dev->get_device_pid(), hca_dev->get_gid_idx(), remote_qp);
+}
+
+bool hartebeest::HartebeestCore::memc_push_local_qp(const char* memc_key, const char* pd_key, const char* qp_key) {
+
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    hartebeest::Qp* local_qp = local_pd->get_qp_cache().get_resrc(qp_key);
+
+    hb_retcode hb_rc;
+    hb_rc = HARTEBEEST_MEMC_HDL.set(memc_key, encode_qp(local_qp));
+
+    if (hb_rc.ret_code == MEMCH_SET_OK)
+        return true;
+    
+    return false;
+}
+
+bool hartebeest::HartebeestCore::memc_fetch_remote_qp(const char* remote_qp_key) {
+    std::string fetched{""};
+
+    if (HARTEBEEST_MEMC_HDL.wait_get(remote_qp_key, fetched).ret_code != MEMCH_GET_OK)
+        return false;
+
+    hartebeest::Qp* remote_qp = register_remote_qp(remote_qp_key, fetched);
+    if (remote_qp == nullptr)
+        return false;
+
+    HB_CLOGGER->info("Fetch MEMC: {}, 0x{:x}", remote_qp_key, uintptr_t(remote_qp));
+
+    return true;
+}
+
+bool hartebeest::HartebeestCore::memc_fetch_remote_qps(const std::vector<std::string>& remote_qp_keys) {
+    bool all_fetched = memc_fetch_bulk(remote_qp_keys, [&](const std::string& key, const std::string& fetched) {
+        register_remote_qp(key.c_str(), fetched);
+    });
+
+    HB_CLOGGER->info("Fetch MEMC: {} remote QPs", remote_qp_keys.size());
+    return all_fetched;
+}
+
+// Each round asks only for the keys still missing, and hands every arrival
+// to on_fetch right away. False if some never showed up before the deadline.
+bool hartebeest::HartebeestCore::memc_fetch_bulk(
+        const std::vector<std::string>& keys, 
+        const std::function<void(const std::string&, const std::string&)>& on_fetch
+    ) {
+    std::vector<std::string> missing(keys);
+    std::map<std::string, std::string> fetched;
+
+    hartebeest::Backoff backoff;
+    int n_rounds = 0;
+
+    while (missing.size() > 0) {
+        if (n_rounds++ > 0) {
+            if (backoff.expired()) {
+                HB_CLOGGER->warn("Bulk fetch gave up after {} ms, {} of {} keys missing, first: {}", 
+                    backoff.get_elapsed_ms(), missing.size(), keys.size(), missing[0]);
+                return false;
+            }
+
+            backoff.wait();
+        }
+
+        fetched.clear();
+        if (HARTEBEEST_MEMC_HDL.mget(missing, fetched).ret_code != MEMCH_MGET_OK)
+            continue;
+
+        std::vector<std::string> still_missing;
+        for (auto& key: missing) {
+            auto it = fetched.find(key);
+            if (it == fetched.end())
+                still_missing.push_back(key);
+            else
+                on_fetch(key, it->second);
+        }
+
+        missing.swap(still_missing);
+    }
+
+    HB_CLOGGER->info("Bulk fetch of {} keys: {} ms, {} rounds", 
+        keys.size(), backoff.get_elapsed_ms(), n_rounds);
+    return true;
+}
+
+hartebeest::Qp* hartebeest::HartebeestCore::register_remote_qp(const char* remote_qp_key, const std::string& fetched) {
+    
+    // A reconnecting peer advertises a new QP under the same key.
+    hartebeest::Qp* stale_qp = remote_qp_cache.get_resrc(remote_qp_key);
+    if (stale_qp != nullptr) {
+        remote_qp_cache.deregister_resrc(remote_qp_key);
+        delete stale_qp;
+    }
+
+    hartebeest::Qp* remote_qp = decode_qp(remote_qp_key, fetched);
+    if (remote_qp == nullptr)
+        return nullptr;
+
+    remote_qp_cache.register_resrc(remote_qp_key, remote_qp);
+
+    return remote_qp;
+}
+
+// exc_attr wire.binary picks the format. Fetches take either.
+std::string hartebeest::HartebeestCore::encode_mr(hartebeest::Mr* local_mr) {
+    int* binary = HB_CFG_LOADER.get_attr("wire.binary");
+    if (binary != nullptr && *binary == 0)
+        return local_mr->flatten_info();
+
+    hartebeest::WireWriter writer;
+    local_mr->encode_wire(writer);
+
+    return writer.finish();
+}
+
+std::string hartebeest::HartebeestCore::encode_qp(hartebeest::Qp* local_qp) {
+    int* binary = HB_CFG_LOADER.get_attr("wire.binary");
+    if (binary != nullptr && *binary == 0)
+        return local_qp->flatten_info();
+
+    hartebeest::WireWriter writer;
+    local_qp->encode_wire(writer);
+
+    return writer.finish();
+}
+
+// A single-resource value carries one record. Bundles go through memc_fetch_remote_bundle().
+hartebeest::Mr* hartebeest::HartebeestCore::decode_mr(const char* remote_mr_key, const std::string& fetched) {
+    hartebeest::Mr* remote_mr = new hartebeest::Mr(remote_mr_key, 0);
+
+    if (!hartebeest::is_wire_format(fetched)) {
+        remote_mr->unflatten_info(fetched.c_str());
+        return remote_mr;
+    }
+
+    hartebeest::WireReader reader(fetched);
+    const hartebeest::WireRecord* rec = reader.next();
+
+    if (!is_valid_wire_mr(rec)) {
+        HB_CLOGGER->warn("Malformed MR record at {}", remote_mr_key);
+        delete remote_mr;
+        return nullptr;
+    }
+
+    remote_mr->decode_wire(reinterpret_cast<const hartebeest::WireMr*>(rec));
+    return remote_mr;
+}
+
+hartebeest::Qp* hartebeest::HartebeestCore::decode_qp(const char* remote_qp_key, const std::string& fetched) {
+    hartebeest::Qp* remote_qp = new hartebeest::Qp(remote_qp_key, IBV_QPT_RAW_PACKET, 0, 0, 0);
+
+    if (!hartebeest::is_wire_format(fetched)) {
+        remote_qp->unflatten_info(fetched.c_str());
+        return remote_qp;
+    }
+
+    hartebeest::WireReader reader(fetched);
+    const hartebeest::WireRecord* rec = reader.next();
+
+    if (!is_valid_wire_qp(rec)) {
+        HB_CLOGGER->warn("Malformed QP record at {}", remote_qp_key);
+        delete remote_qp;
+        return nullptr;
+    }
+
+    remote_qp->decode_wire(reinterpret_cast<const hartebeest::WireQp*>(rec));
+    return remote_qp;
+}
+
+bool hartebeest::HartebeestCore::memc_push_bundle(
+        const char* memc_key, const char* pd_key, 
+        const std::vector<std::string>& mr_keys, const std::vector<std::string>& qp_keys
+    ) {
+    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(local_pd != nullptr);
+
+    hartebeest::WireWriter writer;
+
+    for (auto& mr_key: mr_keys) {
+        hartebeest::Mr* local_mr = local_pd->get_mr_cache().get_resrc(mr_key.c_str());
+        assert(local_mr != nullptr);
+
+        local_mr->encode_wire(writer);
+    }
+
+    for (auto& qp_key: qp_keys) {
+        hartebeest::Qp* local_qp = local_pd->get_qp_cache().get_resrc(qp_key.c_str());
+        assert(local_qp != nullptr);
+
+        local_qp->encode_wire(writer);
+    }
+
+    const std::string& value = writer.finish();
+    HB_CLOGGER->info("Bundle {}: {} records, {} bytes", memc_key, writer.get_n_records(), value.size());
+
+    return (HARTEBEEST_MEMC_HDL.set(memc_key, value).ret_code == MEMCH_SET_OK);
+}
+
+bool hartebeest::HartebeestCore::memc_fetch_remote_bundle(const char* memc_key) {
+    std::string fetched;
+
+    if (HARTEBEEST_MEMC_HDL.wait_get(memc_key, fetched).ret_code != MEMCH_GET_OK)
+        return false;
+
+    return register_remote_bundle(memc_key, fetched);
+}
+
+// Each record is registered as "<memc_key>/<resource name>".
+bool hartebeest::HartebeestCore::register_remote_bundle(const char* memc_key, const std::string& fetched, bool quiet) {
+
+    if (!hartebeest::is_wire_format(fetched)) {
+        HB_CLOGGER->warn("Bundle {} is not in the binary format", memc_key);
+        return false;
+    }
+
+    hartebeest::WireReader reader(fetched);
+    const hartebeest::WireRecord* rec;
+    int n_records = 0;
+
+    while ((rec = reader.next()) != nullptr) {
+        std::string remote_key = std::string(memc_key) + "/" + hartebeest::wire_name(rec);
+
+        if (is_valid_wire_mr(rec)) {
+            hartebeest::Mr* stale_mr = remote_mr_cache.get_resrc(remote_key.c_str());
+            if (stale_mr != nullptr) {
+                remote_mr_cache.deregister_resrc(remote_key.c_str());
+                delete stale_mr;
+            }
+
+            hartebeest::Mr* remote_mr = new hartebeest::Mr(remote_key.c_str(), 0);
+            remote_mr->decode_wire(reinterpret_cast<const hartebeest::WireMr*>(rec));
+            remote_mr_cache.register_resrc(remote_key.c_str(), remote_mr);
+        }
+        else if (is_valid_wire_qp(rec)) {
+            hartebeest::Qp* stale_qp = remote_qp_cache.get_resrc(remote_key.c_str());
+            if (stale_qp != nullptr) {
+                remote_qp_cache.deregister_resrc(remote_key.c_str());
+                delete stale_qp;
+            }
+
+            hartebeest::Qp* remote_qp = new hartebeest::Qp(remote_key.c_str(), IBV_QPT_RAW_PACKET, 0, 0, 0);
+            remote_qp->decode_wire(reinterpret_cast<const hartebeest::WireQp*>(rec));
+            remote_qp_cache.register_resrc(remote_key.c_str(), remote_qp);
+        }
+        else {
+            HB_CLOGGER->warn("Bundle {}: skipping record {} of kind {}", memc_key, hartebeest::wire_name(rec), rec->kind);
+            continue;
+        }
+
+        n_records++;
+    }
+
+    if (!quiet)
+        HB_CLOGGER->info("Fetch MEMC bundle: {}, {} records", memc_key, n_records);
+    return true;
+}
+
+// Each phase is spread over n_threads workers, except for the exchanger
+// calls which share one handle. Per-QP info logs are held back and one
+// summary line is printed instead; warnings still come through.
+bool hartebeest::HartebeestCore::connect_local_qp_bulk(
+        const std::vector<QpConnSpec>& specs, enum ibv_qp_type conn_type, 
+        const char* sendcq_key, const char* recvcq_key, int n_threads
+    ) {
+
+    struct ibv_cq* send_cq = HB_BASICCQ_CACHE.get_resrc(sendcq_key)->get_cq();
+    struct ibv_cq* recv_cq = HB_BASICCQ_CACHE.get_resrc(recvcq_key)->get_cq();
+
+    assert((send_cq != nullptr) && (recv_cq != nullptr));
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t n_specs = specs.size();
+    std::vector<hartebeest::Qp*> local_qps(n_specs, nullptr);
+    std::atomic<int> n_failed(0);
+    std::mutex cache_mtx;
+
+    // 1. Create (or reuse) and bring to INIT.
+    parallel_for(n_specs, n_threads, [&](size_t idx) {
+        const QpConnSpec& spec = specs[idx];
+        hartebeest::Pd* pd = HB_PD_CACHE.get_resrc(spec.pd_key.c_str());
+        assert(pd != nullptr);
+
+        hartebeest::Qp* qp;
+        {
+            std::lock_guard<std::mutex> guard(cache_mtx);
+            qp = pd->get_qp_cache().get_resrc(spec.qp_key.c_str());
+        }
+
+        if (qp == nullptr) {
+            qp = new hartebeest::Qp(spec.qp_key.c_str(), conn_type, pd, send_cq, recv_cq, nullptr, true);
+            if (!qp->is_qp_created()) {
+                delete qp;
+                n_failed++;
+                return;
+            }
+            
+            std::lock_guard<std::mutex> guard(cache_mtx);
+            pd->get_qp_cache().register_resrc(spec.qp_key.c_str(), qp);
+        }
+
+        if (qp->query_state() == IBV_QPS_RESET &&
+            qp->transit_init().ret_code != QP_TRANSITION_2_INIT_OK) {
+            n_failed++;
+            return;
+        }
+
+        local_qps[idx] = qp;
+    });
+
+    // 2. Advertise, pipelined in one multi-set.
+    std::map<std::string, std::string> local_records;
+
+    for (size_t idx = 0; idx < n_specs; idx++) {
+        if (local_qps[idx] != nullptr)
+            local_records[specs[idx].local_memc_key] = encode_qp(local_qps[idx]);
+    }
+
+    if (HARTEBEEST_MEMC_HDL.mset(local_records).ret_code != MEMCH_MSET_OK) {
+        for (size_t idx = 0; idx < n_specs; idx++) {
+            if (local_qps[idx] != nullptr) {
+                n_failed++;
+                local_qps[idx] = nullptr;
+            }
+        }
+    }
+
+    // 3. Fetch the peers, all in one multi-get per round.
+    std::vector<hartebeest::Qp*> remote_qps(n_specs, nullptr);
+    std::vector<std::string> remote_keys;
+    std::map<std::string, size_t> remote_idxs;
+
+    for (size_t idx = 0; idx < n_specs; idx++) {
+        if (local_qps[idx] == nullptr)
+            continue;
+
+        remote_keys.push_back(specs[idx].remote_memc_key);
+        remote_idxs[specs[idx].remote_memc_key] = idx;
+    }
+
+    memc_fetch_bulk(remote_keys, [&](const std::string& key, const std::string& fetched) {
+        remote_qps[remote_idxs[key]] = register_remote_qp(key.c_str(), fetched);
+    });
+
+    // 4. RTR and RTS.
+    parallel_for(n_specs, n_threads, [&](size_t idx) {
+        if (local_qps[idx] == nullptr)
+            return;
+
+        if (remote_qps[idx] == nullptr) {
+            n_failed++;
+            return;
+        }
+
+        if (local_qps[idx]->transit_rtr(remote_qps[idx]).ret_code != QP_TRANSITION_2_RTR_OK ||
+            local_qps[idx]->transit_rts().ret_code != QP_TRANSITION_2_RTS_OK)
+            n_failed++;
+    });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    HB_CLOGGER->info("Bulk connected {}/{} QPs in {} ms, {} threads", 
+        n_specs - n_failed.load(), n_specs, elapsed, n_threads);
+
+    return (n_failed.load() == 0);
+}
+
+std::vector<int> hartebeest::HartebeestCore::get_peers(int topology) {
+
+    std::vector<int> participants = HARTEBEEST_MEMC_HDL.get_participants();
+    std::vector<int> peers;
+
+    auto self = std::find(participants.begin(), participants.end(), nid);
+    if (self == participants.end()) {
+        HB_CLOGGER->warn("Node {} is not in HARTEBEEST_PARTICIPANTS", nid);
+        return peers;
+    }
+
+    size_t n_nodes = participants.size();
+    size_t self_idx = self - participants.begin();
+
+    switch (topology) {
+    case HB_TOPOLOGY_RING:
+        if (n_nodes > 1)
+            peers.push_back(participants[(self_idx + n_nodes - 1) % n_nodes]);
+        if (n_nodes > 2)
+            peers.push_back(participants[(self_idx + 1) % n_nodes]);
+        break;
+
+    case HB_TOPOLOGY_STAR:
+        if (self_idx != 0) {
+            peers.push_back(participants[0]);
+            break;
+        }
+        // Fall through, the hub sees everyone.
+
+    case HB_TOPOLOGY_MESH:
+    default:
+        for (auto peer: participants)
+            if (peer != nid)
+                peers.push_back(peer);
+        break;
+    }
+
+    std::sort(peers.begin(), peers.end());
+    return peers;
+}
+
+// Local QP to a peer is "<pd_key>-qp-<nid>-<peer>", and every node pushes
+// its MR and QPs as one bundle "<pd_key>-all-<nid>". Hence pd_key and
+// mr_key must be the same on all participants.
+bool hartebeest::HartebeestCore::connect_all(
+        const char* pd_key, const char* mr_key, const char* cq_key, 
+        int topology, enum ibv_qp_type conn_type, int n_threads
+    ) {
+
+    hartebeest::Pd* pd = HB_PD_CACHE.get_resrc(pd_key);
+    hartebeest::BasicCq* cq = HB_BASICCQ_CACHE.get_resrc(cq_key);
+
+    assert((pd != nullptr) && (cq != nullptr));
+    assert(pd->get_mr_cache().get_resrc(mr_key) != nullptr);
+
+    std::vector<int> peers = get_peers(topology);
+    if (peers.empty())
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::string prefix(pd_key);
+    size_t n_peers = peers.size();
+
+    // A mesh also connects the metadata plane, if create_meta_plane() made one.
+    bool with_meta = (topology == HB_TOPOLOGY_MESH && meta.cq != nullptr && meta.pd_key == prefix);
+    size_t n_qps = with_meta ? 2 * n_peers : n_peers;
+
+    // QP idx goes to peers[idx % n_peers], the second half is the metadata plane.
+    auto qp_name = [&](size_t idx, int from, int to) {
+        return prefix + ((idx < n_peers) ? "-qp-" : "-meta-qp-") + std::to_string(from) + "-" + std::to_string(to);
+    };
+
+    std::vector<std::string> qp_keys(n_qps);
+    std::vector<hartebeest::Qp*> local_qps(n_qps, nullptr);
+    std::atomic<int> n_failed(0);
+    std::mutex cache_mtx;
+
+    // 1. One QP per peer, brought to INIT.
+    parallel_for(n_qps, n_threads, [&](size_t idx) {
+        qp_keys[idx] = qp_name(idx, nid, peers[idx % n_peers]);
+
+        hartebeest::Qp* qp;
+        {
+            std::lock_guard<std::mutex> guard(cache_mtx);
+            qp = pd->get_qp_cache().get_resrc(qp_keys[idx].c_str());
+        }
+
+        if (qp == nullptr) {
+            qp = (idx < n_peers) ?
+                new hartebeest::Qp(qp_keys[idx].c_str(), conn_type, pd, cq->get_cq(), cq->get_cq(), nullptr, true) :
+                new hartebeest::Qp(qp_keys[idx].c_str(), IBV_QPT_RC, pd, meta.cq->get_cq(), meta.cq->get_cq(), nullptr, true);
+            if (!qp->is_qp_created()) {
+                delete qp;
+                n_failed++;
+                return;
+            }
+
+            std::lock_guard<std::mutex> guard(cache_mtx);
+            pd->get_qp_cache().register_resrc(qp_keys[idx].c_str(), qp);
+        }
+
+        if (qp->query_state() == IBV_QPS_RESET &&
+            qp->transit_init().ret_code != QP_TRANSITION_2_INIT_OK) {
+            n_failed++;
+            return;
+        }
+
+        local_qps[idx] = qp;
+    });
+
+    if (n_failed.load() != 0) {
+        HB_CLOGGER->warn("connect_all: {} QPs failed to initialize", n_failed.load());
+        return false;
+    }
+
+    // 2. Everything local goes out in one set.
+    std::string local_bundle = prefix + "-all-" + std::to_string(nid);
+
+    // The RDMA directory, if any, rides along.
+    std::vector<std::string> mr_keys{mr_key};
+    std::string dir_key = prefix + "-dir";
+
+    if (pd->get_mr_cache().get_resrc(dir_key.c_str()) != nullptr)
+        mr_keys.push_back(dir_key);
+
+    if (!memc_push_bundle(local_bundle.c_str(), pd_key, mr_keys, qp_keys))
+        return false;
+
+    // 3. Peers' bundles, all in one multi-get per round, or through the group leaders.
+    std::vector<std::string> remote_bundles;
+    for (auto peer: peers)
+        remote_bundles.push_back(prefix + "-all-" + std::to_string(peer));
+
+    int group_size = get_exc_attr("tree.group_size", 0);
+
+    if (topology == HB_TOPOLOGY_MESH && group_size > 0 && 
+        HARTEBEEST_MEMC_HDL.get_participants().size() > static_cast<size_t>(group_size)) {
+
+        if (!fetch_bundles_tree(prefix, group_size)) {
+            HB_CLOGGER->warn("connect_all: group exchange of {} bundles failed", prefix);
+            return false;
+        }
+    }
+    else {
+        bool all_fetched = memc_fetch_bulk(remote_bundles, [&](const std::string& key, const std::string& fetched) {
+            register_remote_bundle(key.c_str(), fetched, true);
+        });
+
+        if (!all_fetched) {
+            HB_CLOGGER->warn("connect_all: not every peer bundle of {} arrived", prefix);
+            return false;
+        }
+    }
+
+    // 4. RTR and RTS. The peer's QP towards us is "<pd_key>-qp-<peer>-<nid>".
+    std::vector<hartebeest::Qp*> remote_qps(n_qps, nullptr);
+    for (size_t idx = 0; idx < n_qps; idx++) {
+        std::string remote_key = remote_bundles[idx % n_peers] + "/" + qp_name(idx, peers[idx % n_peers], nid);
+        remote_qps[idx] = remote_qp_cache.get_resrc(remote_key.c_str());
+    }
+
+    parallel_for(n_qps, n_threads, [&](size_t idx) {
+        if (remote_qps[idx] == nullptr) {
+            n_failed++;
+            return;
+        }
+
+        if (local_qps[idx]->transit_rtr(remote_qps[idx]).ret_code != QP_TRANSITION_2_RTR_OK ||
+            local_qps[idx]->transit_rts().ret_code != QP_TRANSITION_2_RTS_OK)
+            n_failed++;
+    });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    HB_CLOGGER->info("connect_all: {}/{} QPs connected in {} ms, {} threads", 
+        n_qps - n_failed.load(), n_qps, elapsed, n_threads);
+
+    return (n_failed.load() == 0);
+}
+
+hartebeest::Qp* hartebeest::HartebeestCore::get_peer_qp(const char* pd_key, int peer) {
+    std::string qp_key = std::string(pd_key) + "-qp-" + std::to_string(nid) + "-" + std::to_string(peer);
+    return get_local_qp(pd_key, qp_key.c_str());
+}
+
+hartebeest::Mr* hartebeest::HartebeestCore::get_peer_mr(const char* pd_key, const char* mr_key, int peer) {
+    std::string remote_key = std::string(pd_key) + "-all-" + std::to_string(peer) + "/" + mr_key;
+    return get_remote_mr(remote_key.c_str());
+}
+
+// Call before connect_all(), which then connects a second, RC QP to every
+// mesh peer on this CQ. Barrier and directory traffic goes there, so it
+// never takes the completions of the application's sends.
+bool hartebeest::HartebeestCore::create_meta_plane(const char* pd_key) {
+
+    if (meta.cq != nullptr)
+        return (meta.pd_key == pd_key);
+
+    std::string cq_key = std::string(pd_key) + "-meta-cq";
+    if (!create_basiccq(cq_key.c_str()))
+        return false;
+
+    meta.pd_key = pd_key;
+    meta.cq = HB_BASICCQ_CACHE.get_resrc(cq_key.c_str());
+
+    return true;
+}
+
+hartebeest::Qp* hartebeest::HartebeestCore::get_meta_qp(int peer) {
+    std::string qp_key = meta.pd_key + "-meta-qp-" + std::to_string(nid) + "-" + std::to_string(peer);
+    return get_local_qp(meta.pd_key.c_str(), qp_key.c_str());
+}
+
+// Waits for n_wcs completions of wr_id on the metadata CQ, or the deadline.
+// Late completions of an earlier, expired wait carry another wr_id and are
+// dropped. Hold meta.mtx.
+bool hartebeest::HartebeestCore::meta_poll(uint64_t wr_id, size_t n_wcs, const hartebeest::Backoff& deadline) {
+    struct ibv_wc wc;
+    struct ibv_cq* cq = meta.cq->get_cq();
+
+    while (n_wcs > 0) {
+        int nwc = ibv_poll_cq(cq, 1, &wc);
+
+        if (nwc < 0) {
+            HB_CLOGGER->warn("Metadata CQ poll failed: {}", nwc);
+            return false;
+        }
+
+        if (nwc == 0) {
+            if (deadline.expired()) {
+                HB_CLOGGER->warn("Metadata plane: {} completions missing", n_wcs);
+                return false;
+            }
+            continue;
+        }
+
+        if (wc.wr_id != wr_id)
+            continue;
+
+        if (wc.status != IBV_WC_SUCCESS) {
+            HB_CLOGGER->warn("Expected IBV_WC_SUCCESS, but returned: {}", wc.status);
+            return false;
+        }
+
+        n_wcs--;
+    }
+
+    return true;
+}
+
+// Every participant owns an 8-byte slot at offset + 8 * (its rank in
+// HARTEBEEST_PARTICIPANTS) of the MR, on every node. Needs a mesh by
+// connect_all() with the same pd_key and mr_key, and the metadata plane
+// of that PD. Collective, every participant calls it.
+bool hartebeest::HartebeestCore::arm_rdma_barrier(const char* pd_key, const char* mr_key, size_t offset) {
+
+    std::vector<int> participants = HARTEBEEST_MEMC_HDL.get_participants();
+    hartebeest::Mr* local_mr = get_local_mr(pd_key, mr_key);
+
+    if (local_mr == nullptr || 
+        offset + participants.size() * sizeof(uint64_t) > local_mr->get_mr()->length) {
+        HB_CLOGGER->warn("RDMA barrier: no room for {} slots in {}", participants.size(), mr_key);
+        return false;
+    }
+
+    if (meta.cq == nullptr || meta.pd_key != pd_key) {
+        HB_CLOGGER->warn("RDMA barrier: no metadata plane on {}", pd_key);
+        return false;
+    }
+
+    for (auto peer: get_peers(HB_TOPOLOGY_MESH)) {
+        if (get_meta_qp(peer) == nullptr || get_peer_mr(pd_key, mr_key, peer) == nullptr) {
+            HB_CLOGGER->warn("RDMA barrier: peer {} is not connected", peer);
+            return false;
+        }
+    }
+
+    std::memset(local_mr->get_buffer() + offset, 0, participants.size() * sizeof(uint64_t));
+
+    // A faster peer must not write generation 1 into a slot we are yet to clear.
+    std::string arm_key = std::string(pd_key) + "-rdma-barrier-arm";
+    if (HARTEBEEST_MEMC_HDL.barrier(arm_key.c_str(), participants.size()).ret_code != MEMCH_BARRIER_OK) {
+        HB_CLOGGER->warn("RDMA barrier: peers did not arm in time");
+        return false;
+    }
+
+    rdma_barrier.pd_key = pd_key;
+    rdma_barrier.mr_key = mr_key;
+    rdma_barrier.offset = offset;
+    rdma_barrier.gen = 0;
+    rdma_barrier.armed = true;
+
+    return true;
+}
+
+// Falls back to the exchanger counter until arm_rdma_barrier() succeeds.
+bool hartebeest::HartebeestCore::barrier(const char* key) {
+
+    if (rdma_barrier.armed)
+        return barrier_rdma();
+
+    int n_nodes = HARTEBEEST_MEMC_HDL.get_participants().size();
+    return (HARTEBEEST_MEMC_HDL.barrier(key, n_nodes).ret_code == MEMCH_BARRIER_OK);
+}
+
+// Writes the new generation into its own slot on every peer over the
+// metadata plane, then spins on the local slots. Both waits end at
+// exc_attr wait.deadline_ms.
+bool hartebeest::HartebeestCore::barrier_rdma() {
+
+    std::vector<int> participants = HARTEBEEST_MEMC_HDL.get_participants();
+    size_t self_idx = std::find(participants.begin(), participants.end(), nid) - participants.begin();
+
+    const char* pd_key = rdma_barrier.pd_key.c_str();
+    const char* mr_key = rdma_barrier.mr_key.c_str();
+
+    hartebeest::Mr* local_mr = get_local_mr(pd_key, mr_key);
+    volatile uint64_t* slots = reinterpret_cast<volatile uint64_t*>(local_mr->get_buffer() + rdma_barrier.offset);
+
+    uint64_t gen = ++rdma_barrier.gen;
+    slots[self_idx] = gen;
+
+    size_t slot_off = rdma_barrier.offset + self_idx * sizeof(uint64_t);
+    std::vector<int> peers = get_peers(HB_TOPOLOGY_MESH);
+
+    hartebeest::Backoff deadline;
+    {
+        std::lock_guard<std::mutex> guard(meta.mtx);
+        uint64_t wr_id = ++meta.wr_id;
+
+        size_t n_posted = 0;
+        for (auto peer: peers) {
+            struct ibv_mr* remote_mr = get_peer_mr(pd_key, mr_key, peer)->get_mr();
+
+            if (!rdma_post_single_fast(get_meta_qp(peer)->get_qp(), 
+                    const_cast<uint64_t*>(&slots[self_idx]), 
+                    reinterpret_cast<uint8_t*>(remote_mr->addr) + slot_off, sizeof(uint64_t), 
+                    IBV_WR_RDMA_WRITE, local_mr->get_mr()->lkey, remote_mr->rkey, wr_id))
+                break;
+            n_posted++;
+        }
+
+        if (!meta_poll(wr_id, n_posted, deadline) || n_posted != peers.size())
+            return false;
+    }
+
+    for (size_t idx = 0; idx < participants.size(); idx++) {
+        while (slots[idx] < gen) {
+            if (deadline.expired()) {
+                HB_CLOGGER->warn("RDMA barrier gen {}: node {} did not arrive", gen, participants[idx]);
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    return true;
+}
+
+// The directory MR "<pd_key>-dir" goes out with connect_all(), so create
+// it before. It is read over the metadata plane of the same PD, which this
+// makes if there is none. All participants must pass the same n_entries.
+bool hartebeest::HartebeestCore::create_rdma_directory(const char* pd_key, size_t n_entries) {
+
+    hartebeest::Pd* pd = HB_PD_CACHE.get_resrc(pd_key);
+    assert(pd != nullptr);
+
+    if (rdma_dir.local != nullptr) {
+        HB_CLOGGER->warn("RDMA directory already exists under {}", rdma_dir.pd_key);
+        return false;
+    }
+
+    if (!create_meta_plane(pd_key)) {
+        HB_CLOGGER->warn("RDMA directory: metadata plane is on {}, not {}", meta.pd_key, pd_key);
+        return false;
+    }
+
+    size_t n_participants = HARTEBEEST_MEMC_HDL.get_participants().size();
+    size_t region_size = hartebeest::Directory::region_size(n_participants, n_entries);
+
+    std::string dir_key = std::string(pd_key) + "-dir";
+    std::string scratch_key = dir_key + "-scratch";
+
+    int rights = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE;
+
+    if (pd->create_mr(dir_key.c_str(), region_size, rights).ret_code != PD_RETCODE_CREATE_MR_OK ||
+        pd->create_mr(scratch_key.c_str(), DIR_READ_WINDOW * sizeof(DirEntry), IBV_ACCESS_LOCAL_WRITE).ret_code != PD_RETCODE_CREATE_MR_OK)
+        return false;
+
+    rdma_dir.pd_key = pd_key;
+    rdma_dir.local = new hartebeest::Directory(
+        pd->get_mr_cache().get_resrc(dir_key.c_str())->get_buffer(), n_participants, n_entries);
+    rdma_dir.scratch = pd->get_mr_cache().get_resrc(scratch_key.c_str());
+
+    return true;
+}
+
+// From here on, memc_push_local_mr() publishes to the local directory and
+// memc_fetch_remote_mr() reads the owner's directory first.
+bool hartebeest::HartebeestCore::arm_rdma_directory(const char* pd_key) {
+
+    if (rdma_dir.local == nullptr || rdma_dir.pd_key != pd_key)
+        return false;
+
+    std::string dir_key = std::string(pd_key) + "-dir";
+
+    for (auto peer: get_peers(HB_TOPOLOGY_MESH)) {
+        if (get_meta_qp(peer) == nullptr || get_peer_mr(pd_key, dir_key.c_str(), peer) == nullptr) {
+            HB_CLOGGER->warn("RDMA directory: peer {} is not connected", peer);
+            return false;
+        }
+    }
+
+    rdma_dir.armed = true;
+    return true;
+}
+
+// Bumped by a peer each time it publishes.
+uint64_t hartebeest::HartebeestCore::rdma_dir_generation(int peer) {
+
+    std::vector<int> participants = HARTEBEEST_MEMC_HDL.get_participants();
+    size_t peer_idx = std::find(participants.begin(), participants.end(), peer) - participants.begin();
+
+    assert(rdma_dir.local != nullptr && peer_idx < participants.size());
+    return *rdma_dir.local->inbox(peer_idx);
+}
+
+// The entry is written locally. The new generation then goes to our inbox
+// slot on every peer, by plain RDMA writes on the metadata plane. False if
+// the entry does not fit, or a peer missed the generation.
+bool hartebeest::HartebeestCore::rdma_dir_publish(const std::string& key, const std::string& value) {
+
+    std::lock_guard<std::mutex> guard(rdma_dir.mtx);
+
+    if (!rdma_dir.local->publish(key, value))
+        return false;
+
+    std::vector<int> participants = HARTEBEEST_MEMC_HDL.get_participants();
+    size_t self_idx = std::find(participants.begin(), participants.end(), nid) - participants.begin();
+
+    const char* pd_key = rdma_dir.pd_key.c_str();
+    std::string dir_key = rdma_dir.pd_key + "-dir";
+
+    hartebeest::Mr* local_mr = get_local_mr(pd_key, dir_key.c_str());
+    volatile uint64_t* gen_slot = rdma_dir.local->inbox(self_idx);
+
+    *gen_slot = ++rdma_dir.gen;
+
+    std::vector<int> peers = get_peers(HB_TOPOLOGY_MESH);
+    hartebeest::Backoff deadline;
+
+    std::lock_guard<std::mutex> meta_guard(meta.mtx);
+    uint64_t wr_id = ++meta.wr_id;
+
+    size_t n_posted = 0;
+    for (auto peer: peers) {
+        struct ibv_mr* remote_mr = get_peer_mr(pd_key, dir_key.c_str(), peer)->get_mr();
+
+        if (!rdma_post_single_fast(get_meta_qp(peer)->get_qp(), 
+                const_cast<uint64_t*>(gen_slot), 
+                reinterpret_cast<uint8_t*>(remote_mr->addr) + self_idx * sizeof(uint64_t), sizeof(uint64_t), 
+                IBV_WR_RDMA_WRITE, local_mr->get_mr()->lkey, remote_mr->rkey, wr_id))
+            break;
+        n_posted++;
+    }
+
+    return (meta_poll(wr_id, n_posted, deadline) && n_posted == peers.size());
+}
+
+// Reads only the key's probe run in the owner's directory, DIR_READ_WINDOW
+// entries at a time, from its home slot on. A torn copy is read again.
+bool hartebeest::HartebeestCore::rdma_dir_lookup(
+        int owner, const std::string& key, std::string& value, const hartebeest::Backoff& deadline
+    ) {
+
+    std::lock_guard<std::mutex> guard(rdma_dir.mtx);
+
+    if (owner == nid)
+        return rdma_dir.local->lookup(key, value);
+
+    const char* pd_key = rdma_dir.pd_key.c_str();
+    std::string dir_key = rdma_dir.pd_key + "-dir";
+
+    hartebeest::Qp* meta_qp = get_meta_qp(owner);
+    hartebeest::Mr* owner_mr = get_peer_mr(pd_key, dir_key.c_str(), owner);
+
+    if (meta_qp == nullptr || owner_mr == nullptr) {
+        HB_CLOGGER->warn("RDMA directory: node {} is not a connected peer", owner);
+        return false;
+    }
+
+    struct ibv_mr* remote_mr = owner_mr->get_mr();
+
+    size_t entries_off = rdma_dir.local->get_entries_offset();
+    size_t n_entries = rdma_dir.local->get_n_entries();
+
+    size_t slot = hartebeest::Directory::home(key, n_entries);
+    size_t n_probed = 0;
+    int n_torn = 0;
+
+    std::lock_guard<std::mutex> meta_guard(meta.mtx);
+
+    while (n_probed < n_entries && n_torn < 4) {
+        size_t n_window = std::min(DIR_READ_WINDOW, std::min(n_entries - slot, n_entries - n_probed));
+        uint64_t wr_id = ++meta.wr_id;
+
+        if (!rdma_post_single_fast(meta_qp->get_qp(), 
+                rdma_dir.scratch->get_buffer(), 
+                reinterpret_cast<uint8_t*>(remote_mr->addr) + entries_off + slot * sizeof(DirEntry), 
+                n_window * sizeof(DirEntry), 
+                IBV_WR_RDMA_READ, rdma_dir.scratch->get_mr()->lkey, remote_mr->rkey, wr_id) ||
+            !meta_poll(wr_id, 1, deadline))
+            return false;
+
+        enum DirFind found = hartebeest::Directory::find(
+            rdma_dir.scratch->get_buffer(), n_window, key, value);
+
+        if (found == DIR_FOUND)
+            return true;
+        if (found == DIR_NOT_FOUND)
+            break;
+        if (found == DIR_TORN) {
+            n_torn++;
+            continue;
+        }
+
+        n_probed += n_window;
+        slot = (slot + n_window) % n_entries;
+    }
+
+    return false;
+}
+
+// Participants are cut into groups of group_size consecutive node ids, and
+// the first of each is its leader. A leader gathers its members' bundles,
+// hands each other leader the part its group needs in one value, and
+// gives each member one value with what is addressed to it. A member
+// pushes one bundle and reads one value, so the exchanger sees O(N)
+// requests instead of O(N^2). Values keep the original bundle keys.
+bool hartebeest::HartebeestCore::fetch_bundles_tree(const std::string& prefix, int group_size) {
+
+    std::vector<int> participants = HARTEBEEST_MEMC_HDL.get_participants();
+    size_t self_idx = std::find(participants.begin(), participants.end(), nid) - participants.begin();
+
+    size_t n_groups = (participants.size() + group_size - 1) / group_size;
+    size_t group = self_idx / group_size;
+
+    auto group_of = [&](int node) -> size_t {
+        return (std::find(participants.begin(), participants.end(), node) - participants.begin()) / group_size;
+    };
+
+    auto group_members = [&](size_t grp) -> std::vector<int> {
+        std::vector<int> members;
+        for (size_t idx = grp * group_size; idx < participants.size() && idx < (grp + 1) * group_size; idx++)
+            members.push_back(participants[idx]);
+        return members;
+    };
+
+    if (self_idx == group * group_size) {
+        std::vector<int> members = group_members(group);
+
+        // 1. Members' bundles.
+        std::map<std::string, std::string> member_bundles;
+        std::vector<std::string> member_keys;
+
+        for (auto member: members)
+            member_keys.push_back(prefix + "-all-" + std::to_string(member));
+
+        if (!memc_fetch_bulk(member_keys, [&](const std::string& key, const std::string& fetched) {
+                member_bundles[key] = fetched;
+            }))
+            return false;
+
+        // 2. To every leader, what its group needs.
+        std::map<std::string, std::string> to_groups;
+
+        for (size_t dst_group = 0; dst_group < n_groups; dst_group++) {
+            std::map<std::string, std::string> filtered;
+
+            for (auto& bundle: member_bundles)
+                filtered[bundle.first] = filter_bundle(bundle.second, [&](int dst) { return group_of(dst) == dst_group; });
+
+            to_groups[prefix + "-grp-" + std::to_string(group) + "-to-" + std::to_string(dst_group)] = pack_bundles(filtered);
+        }
+
+        if (HARTEBEEST_MEMC_HDL.mset(to_groups).ret_code != MEMCH_MSET_OK)
+            return false;
+
+        // 3. From every leader, what this group needs.
+        std::map<std::string, std::string> all_bundles;
+        std::vector<std::string> group_keys;
+
+        for (size_t src_group = 0; src_group < n_groups; src_group++)
+            group_keys.push_back(prefix + "-grp-" + std::to_string(src_group) + "-to-" + std::to_string(group));
+
+        if (!memc_fetch_bulk(group_keys, [&](const std::string& key, const std::string& fetched) {
+                if (!unpack_bundles(fetched, all_bundles))
+                    HB_CLOGGER->warn("Tree bootstrap: {} is malformed", key);
+            }))
+            return false;
+
+        // 4. To every member, what is addressed to it.
+        std::map<std::string, std::string> to_members;
+
+        for (auto member: members) {
+            std::map<std::string, std::string> filtered;
+            std::string own_key = prefix + "-all-" + std::to_string(member);
+
+            for (auto& bundle: all_bundles) {
+                if (bundle.first != own_key)
+                    filtered[bundle.first] = filter_bundle(bundle.second, [&](int dst) { return dst == member; });
+            }
+
+            to_members[prefix + "-for-" + std::to_string(member)] = pack_bundles(filtered);
+        }
+
+        if (HARTEBEEST_MEMC_HDL.mset(to_members).ret_code != MEMCH_MSET_OK)
+            return false;
+    }
+
+    // Everyone, leaders included, reads one value.
+    std::string fetched;
+    std::string own_key = prefix + "-for-" + std::to_string(nid);
+
+    if (HARTEBEEST_MEMC_HDL.wait_get(own_key.c_str(), fetched).ret_code != MEMCH_GET_OK)
+        return false;
+
+    std::map<std::string, std::string> bundles;
+    if (!unpack_bundles(fetched, bundles))
+        return false;
+
+    for (auto& bundle: bundles)
+        register_remote_bundle(bundle.first.c_str(), bundle.second, true);
+
+    HB_CLOGGER->info("Tree bootstrap: group {}/{}, {} bundles", group, n_groups, bundles.size());
+    return true;
+}
+
+// The endpoint belongs to the calling thread only.
+bool hartebeest::HartebeestCore::create_endpoint(const char* ep_key, int n_peers, size_t buflen, enum ibv_qp_type conn_type) {
+
+    if (HB_LOCAL_ENDPOINT != nullptr) {
+        HB_CLOGGER->warn("This thread already has endpoint {}", HB_LOCAL_ENDPOINT->get_name());
+        return false;
+    }
+
+    hartebeest::Endpoint* new_endpoint = new hartebeest::Endpoint(
+        ep_key, HB_HCA_INITR.get_hca(hca_idx), n_peers, buflen, conn_type);
 
-    assert(n_hca > 0);
-    hb_rc = HB_HCA_INITR.open_device(idx);
-    HB_CLOGGER->info("{}", hb_rc.aux_str);
+    if (!new_endpoint->is_ready()) {
+        delete new_endpoint;
+        return false;
+    }
 
-    hb_rc = HB_HCA_INITR.bind_port(idx, port_num);
-    HB_CLOGGER->info("{}", hb_rc.aux_str);
+    HB_LOCAL_ENDPOINT = new_endpoint;
+    return true;
 }
 
-hartebeest::HartebeestCore::~HartebeestCore() {    
-    HB_CLOGGER->info("Hartebeest core end");
-}
+// Pushes "<memc_prefix>-qp-<peer>" for every peer, and "<memc_prefix>-mr".
+bool hartebeest::HartebeestCore::memc_push_endpoint(const char* memc_prefix) {
 
-bool hartebeest::HartebeestCore::memc_push_general(const char* msg_key) {
+    hartebeest::Endpoint* endpoint = HB_LOCAL_ENDPOINT;
+    assert(endpoint != nullptr);
 
-    const char* empty_str = "  ";
-    hb_retcode hb_rc;
-    hb_rc = HARTEBEEST_MEMC_HDL.set(msg_key, empty_str);
+    std::map<std::string, std::string> local_records;
+    local_records[std::string(memc_prefix) + "-mr"] = encode_mr(endpoint->get_recv_mr());
 
-    if (hb_rc.ret_code == MEMCH_SET_OK)
-        return true;
-    
-    return false;
+    for (int peer = 0; peer < endpoint->get_n_peers(); peer++) {
+        std::string qp_key = std::string(memc_prefix) + "-qp-" + std::to_string(peer);
+        local_records[qp_key] = encode_qp(endpoint->get_qp(peer));
+    }
+
+    return (HARTEBEEST_MEMC_HDL.mset(local_records).ret_code == MEMCH_MSET_OK);
 }
 
-bool hartebeest::HartebeestCore::memc_wait_general(const char* msg_key) {
+// Remote containers go to the endpoint, not to the shared remote caches.
+bool hartebeest::HartebeestCore::connect_endpoint(int peer, const char* remote_qp_key, const char* remote_mr_key) {
 
-    int retry_cnt = 0;
+    hartebeest::Endpoint* endpoint = HB_LOCAL_ENDPOINT;
+    assert(endpoint != nullptr);
 
-    std::string fetched;
-    HB_CLOGGER->info("Message wait: {}", msg_key);
+    std::string fetched{""};
 
-    while (HARTEBEEST_MEMC_HDL.get(msg_key, fetched).ret_code != MEMCH_GET_OK) {
-        
-        retry_cnt += 1;
-        if (retry_cnt == 10000)
-            break;
+    if (HARTEBEEST_MEMC_HDL.wait_get(remote_mr_key, fetched).ret_code != MEMCH_GET_OK)
+        return false;
+
+    hartebeest::Mr* remote_mr = decode_mr(remote_mr_key, fetched);
+    if (remote_mr == nullptr)
+        return false;
 
-        sleep(0.5);
+    if (HARTEBEEST_MEMC_HDL.wait_get(remote_qp_key, fetched).ret_code != MEMCH_GET_OK) {
+        delete remote_mr;
+        return false;
     }
 
-    if (retry_cnt == 10000) {
-        HB_CLOGGER->warn("Message fetch timeout: {}", msg_key);
+    hartebeest::Qp* remote_qp = decode_qp(remote_qp_key, fetched);
+    if (remote_qp == nullptr) {
+        delete remote_mr;
         return false;
     }
-    
-    HB_CLOGGER->info("Message detected: {}", msg_key);
+
+    hb_retcode hb_rc = endpoint->connect(peer, remote_qp, remote_mr);
+    if (hb_rc.ret_code != QP_TRANSITION_2_RTS_OK) {
+        HB_CLOGGER->warn("{}", hb_rc.aux_str);
+
+        delete remote_qp;
+        delete remote_mr;
+        return false;
+    }
+
+    HB_CLOGGER->info("Endpoint {} peer {} connected to: {}", endpoint->get_name(), peer, remote_qp_key);
     return true;
 }
 
-bool hartebeest::HartebeestCore::memc_del_general(const char* msg_key) {
-    hb_retcode hb_rc;
-    hb_rc = HARTEBEEST_MEMC_HDL.del(msg_key);
-
-    if (hb_rc.ret_code == MEMCH_DEL_OK)
-        return true;
-    
-    return false;
+void hartebeest::HartebeestCore::destroy_endpoint() {
+    delete HB_LOCAL_ENDPOINT;
+    HB_LOCAL_ENDPOINT = nullptr;
 }
 
-void hartebeest::HartebeestCore::init() {
-    // Does nothing, but for the call the get_instance().
-    if (1)
-        ;
+hartebeest::Endpoint* hartebeest::HartebeestCore::get_endpoint() {
+    return HB_LOCAL_ENDPOINT;
 }
 
-bool hartebeest::HartebeestCore::create_local_pd(const char* pd_key) {
-    hartebeest::Pd* new_pd = new hartebeest::Pd(
-        pd_key, HB_HCA_INITR.get_hca(hca_idx)
-    );
-    hb_retcode hb_rc = HB_PD_CACHE.register_resrc(pd_key, new_pd);
-    HB_CLOGGER->info("New protection domain {}: {}", pd_key, hb_rc.aux_str);
+bool hartebeest::HartebeestCore::add_rail(int idx, uint8_t port_num) {
 
-    if (hb_rc.ret_code == CACHE_RETCODE_REGISTER_OK)
-        return true;
+    std::vector<std::pair<int, uint8_t>> devs;
+    devs.push_back(std::make_pair(idx, port_num));
 
-    return false;
-}
+    // The core's own QPs stay on the port the device was bound to.
+    std::vector<hartebeest::HcaPort> rail_ports;
 
-bool hartebeest::HartebeestCore::create_local_mr(const char* pd_key, const char* mr_key, size_t buflen, int rights) {
-    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
-    assert(registered_pd != nullptr);
+    hb_retcode hb_rc = HB_HCA_INITR.open_devices(devs, rail_ports);
+    HB_CLOGGER->info("New rail {} (HCA {}, port {}): {}", 
+        rails.size(), idx, static_cast<int>(port_num), hb_rc.aux_str);
 
-    hb_retcode hb_rc = registered_pd->create_mr(mr_key, buflen, rights);
-    HB_CLOGGER->info("New memory region {}, to {}: {}", mr_key, pd_key, hb_rc.aux_str);
+    if (hb_rc.ret_code != HCAINITR_RETCODE_BIND_PORT_OK)
+        return false;
 
-    if (hb_rc.ret_code == PD_RETCODE_CREATE_MR_OK)
-        return true;
-    
-    return false;
+    rails.push_back(rail_ports.front());
+    return true;
 }
 
-bool hartebeest::HartebeestCore::memc_push_local_mr(const char* memc_key, const char* pd_key, const char* mr_key) {
+bool hartebeest::HartebeestCore::create_rail_set(const char* set_key, size_t buflen, int rights, enum ibv_qp_type conn_type) {
 
-    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
-    hartebeest::Mr* local_mr = local_pd->get_mr_cache().get_resrc(mr_key);
+    hartebeest::RailSet* new_set = new hartebeest::RailSet(set_key);
+    
+    hb_retcode hb_rc = new_set->create(rails, buflen, rights, conn_type);
+    HB_CLOGGER->info("New rail set {} over {} rails: {}", set_key, rails.size(), hb_rc.aux_str);
 
-    hb_retcode hb_rc;
-    hb_rc = HARTEBEEST_MEMC_HDL.set(memc_key, local_mr->flatten_info().c_str());
+    if (hb_rc.ret_code != RAIL_RETCODE_CREATE_OK) {
+        delete new_set;
+        return false;
+    }
 
-    if (hb_rc.ret_code == MEMCH_SET_OK)
+    hb_rc = rail_set_cache.register_resrc(set_key, new_set);
+    if (hb_rc.ret_code == CACHE_RETCODE_REGISTER_OK)
         return true;
-    
+
     return false;
 }
 
-bool hartebeest::HartebeestCore::memc_fetch_remote_mr(const char* remote_mr_key) {
-    std::string fetched{""};
+// Pushes every rail's MR and QP as "<memc_prefix>-mr-<rail>", "<memc_prefix>-qp-<rail>".
+bool hartebeest::HartebeestCore::memc_push_rail_set(const char* memc_prefix, const char* set_key) {
 
-    while (HARTEBEEST_MEMC_HDL.get(remote_mr_key, fetched).ret_code != MEMCH_GET_OK)
-        sleep(0.5);
+    hartebeest::RailSet* rail_set = rail_set_cache.get_resrc(set_key);
+    assert(rail_set != nullptr);
 
-    hartebeest::Mr* remote_mr = new hartebeest::Mr(remote_mr_key, 0);
-    remote_mr->unflatten_info(fetched.c_str());
-    remote_mr_cache.register_resrc(remote_mr_key, remote_mr);
+    for (size_t r = 0; r < rail_set->get_n_rails(); r++) {
+        hartebeest::Rail& rail = rail_set->get_rail(r);
+
+        std::string mr_key = std::string(memc_prefix) + "-mr-" + std::to_string(r);
+        std::string qp_key = std::string(memc_prefix) + "-qp-" + std::to_string(r);
 
-    HB_CLOGGER->info("Fetch MEMC: {}, 0x{:x}", fetched, uintptr_t(remote_mr));
+        if (HARTEBEEST_MEMC_HDL.set(mr_key.c_str(), encode_mr(rail.mr)).ret_code != MEMCH_SET_OK)
+            return false;
+        if (HARTEBEEST_MEMC_HDL.set(qp_key.c_str(), encode_qp(rail.qp)).ret_code != MEMCH_SET_OK)
+            return false;
+    }
 
     return true;
 }
 
-bool hartebeest::HartebeestCore::create_basiccq(const char* cq_key) {
-    hartebeest::BasicCq* new_basiccq = new hartebeest::BasicCq(
-        cq_key, 
-        HB_HCA_INITR.get_hca(hca_idx));
+// Assumes the remote opened the same number of rails.
+bool hartebeest::HartebeestCore::connect_rail_set(const char* set_key, const char* remote_memc_prefix) {
 
-    assert(new_basiccq != nullptr);
+    hartebeest::RailSet* rail_set = rail_set_cache.get_resrc(set_key);
+    assert(rail_set != nullptr);
 
-    hb_retcode hb_rc;
-    hb_rc = HB_BASICCQ_CACHE.register_resrc(cq_key, new_basiccq);
-    HB_CLOGGER->info("New basic completion queue {}: {}", cq_key, hb_rc.aux_str);
+    for (size_t r = 0; r < rail_set->get_n_rails(); r++) {
+        hartebeest::Rail& rail = rail_set->get_rail(r);
 
-    if (hb_rc.ret_code == CACHE_RETCODE_REGISTER_OK)
-        return true;
-    
-    return false;
-}
+        std::string mr_key = std::string(remote_memc_prefix) + "-mr-" + std::to_string(r);
+        std::string qp_key = std::string(remote_memc_prefix) + "-qp-" + std::to_string(r);
 
+        if (!memc_fetch_remote_mr(mr_key.c_str()) || !memc_fetch_remote_qp(qp_key.c_str()))
+            return false;
 
-bool hartebeest::HartebeestCore::create_local_qp(const char* pd_key, const char* qp_key, enum ibv_qp_type conn_type, const char* sendcq_key, const char* recvcq_key) {
-    hartebeest::Pd* registered_pd = HB_PD_CACHE.get_resrc(pd_key);
+        rail.remote_mr = get_remote_mr(mr_key.c_str());
+        rail.remote_qp = get_remote_qp(qp_key.c_str());
 
-    assert(registered_pd != nullptr);
+        if (rail.qp->transit_rtr(rail.remote_qp).ret_code != QP_TRANSITION_2_RTR_OK)
+            return false;
+        if (rail.qp->transit_rts().ret_code != QP_TRANSITION_2_RTS_OK)
+            return false;
+    }
 
-    struct ibv_cq* send_cq = HB_BASICCQ_CACHE.get_resrc(sendcq_key)->get_cq();
-    struct ibv_cq* recv_cq = HB_BASICCQ_CACHE.get_resrc(recvcq_key)->get_cq();
+    HB_CLOGGER->info("Rail set {} connected to: {}", set_key, remote_memc_prefix);
+    return true;
+}
 
-    assert((send_cq != nullptr) && (recv_cq != nullptr));
+bool hartebeest::HartebeestCore::rdma_write_striped(const char* set_key, size_t offset, size_t len, size_t stripe_len, int window) {
 
-    hb_retcode hb_rc = registered_pd->create_qp(qp_key, conn_type, send_cq, recv_cq);
-    if (hb_rc.ret_code == hartebeest::PD_RETCODE_CREATE_QP_OK)
+    hartebeest::RailSet* rail_set = rail_set_cache.get_resrc(set_key);
+    assert(rail_set != nullptr);
+
+    hb_retcode hb_rc = rail_set->write_striped(offset, len, stripe_len, window);
+    if (hb_rc.ret_code == RAIL_RETCODE_WRITE_OK)
         return true;
 
+    HB_CLOGGER->warn("{}", hb_rc.aux_str);
     return false;
 }
 
-bool hartebeest::HartebeestCore::init_local_qp(const char* pd_key, const char* qp_key) {
+bool hartebeest::HartebeestCore::rdma_post_single_fast(
+        struct ibv_qp* local_qp, void* local_addr, void* remote_addr, size_t len, 
+        enum ibv_wr_opcode opcode, uint32_t lkey, uint32_t rkey, uint64_t work_id
+    ) {
+        struct ibv_send_wr work_req;
+        struct ibv_sge sg_elem;
+        struct ibv_send_wr* bad_work_req = nullptr;
 
-    hb_retcode hb_rc = HARTEBEEST_CORE_HDL.get_local_qp(pd_key, qp_key)->transit_init();
-    if (hb_rc.ret_code == QP_TRANSITION_2_INIT_OK)
-        return true;
-    
-    return false;
-}
+        std::memset(&sg_elem, 0, sizeof(sg_elem));
+        std::memset(&work_req, 0, sizeof(work_req)); 
 
-bool hartebeest::HartebeestCore::connect_local_qp(const char* pd_key, const char* local_qp_key, const char* remote_qp_key) {
+        sg_elem.addr = reinterpret_cast<uintptr_t>(local_addr);
+        sg_elem.length = len;
+        sg_elem.lkey = lkey;
 
-    hartebeest::Qp* remote_qp = get_remote_qp(remote_qp_key);
-    hartebeest::Qp* local_qp = get_local_qp(pd_key, local_qp_key);
+        work_req.wr_id = work_id;
+        work_req.num_sge = 1;
+        work_req.opcode = opcode;
+        work_req.send_flags = IBV_SEND_SIGNALED;
+        work_req.sg_list = &sg_elem;
+        work_req.next = nullptr;
 
-    assert(remote_qp != nullptr);
-    assert(local_qp != nullptr);
+        work_req.wr.rdma.remote_addr = reinterpret_cast<uintptr_t>(remote_addr);
+        work_req.wr.rdma.rkey = rkey;
 
-    hb_retcode hb_rc = local_qp->transit_rtr(remote_qp);
-    if (hb_rc.ret_code == QP_TRANSITION_2_RTR_ERR) {
-        HB_CLOGGER->warn("{}", hb_rc.aux_str);
-        return false;
-    }
+        int ret = ibv_post_send(local_qp, &work_req, &bad_work_req);
 
-    hb_rc = local_qp->transit_rts();
-    if (hb_rc.ret_code == QP_TRANSITION_2_RTS_ERR) {
-        HB_CLOGGER->warn("{}", hb_rc.aux_str);
-        return false;
-    }
+        if (bad_work_req != nullptr) {
+            HB_CLOGGER->warn("Bad work request");
+            return false;
+        }
+        if (ret != 0) {
+            HB_CLOGGER->warn("RDMA Post unusual return: {}", ret);
+            return false;
+        }
 
-    HB_CLOGGER->info("Local QP(State: RTS) {} connected to: {}", local_qp_key, remote_qp_key);
-    return true;
+        return true;
 }
 
-bool hartebeest::HartebeestCore::memc_push_local_qp(const char* memc_key, const char* pd_key, const char* qp_key) {
+// Same as rdma_post_single_fast, routed to one SRQ behind the remote XRC recv QP.
+bool hartebeest::HartebeestCore::rdma_post_single_xrc(
+        struct ibv_qp* local_qp, void* local_addr, void* remote_addr, size_t len, 
+        enum ibv_wr_opcode opcode, uint32_t lkey, uint32_t rkey, uint32_t remote_srqn, uint64_t work_id
+    ) {
+        struct ibv_send_wr work_req;
+        struct ibv_sge sg_elem;
+        struct ibv_send_wr* bad_work_req = nullptr;
 
-    hartebeest::Pd* local_pd = HB_PD_CACHE.get_resrc(pd_key);
-    hartebeest::Qp* local_qp = local_pd->get_qp_cache().get_resrc(qp_key);
+        std::memset(&sg_elem, 0, sizeof(sg_elem));
+        std::memset(&work_req, 0, sizeof(work_req)); 
 
-    hb_retcode hb_rc;
-    hb_rc = HARTEBEEST_MEMC_HDL.set(
-        memc_key, local_qp->flatten_info().c_str()
-    );
+        sg_elem.addr = reinterpret_cast<uintptr_t>(local_addr);
+        sg_elem.length = len;
+        sg_elem.lkey = lkey;
 
-    if (hb_rc.ret_code == MEMCH_SET_OK)
-        return true;
-    
-    return false;
-}
+        work_req.wr_id = work_id;
+        work_req.num_sge = 1;
+        work_req.opcode = opcode;
+        work_req.send_flags = IBV_SEND_SIGNALED;
+        work_req.sg_list = &sg_elem;
+        work_req.next = nullptr;
 
-bool hartebeest::HartebeestCore::memc_fetch_remote_qp(const char* remote_qp_key) {
-    std::string fetched{""};
+        work_req.qp_type.xrc.remote_srqn = remote_srqn;
 
-    while (HARTEBEEST_MEMC_HDL.get(remote_qp_key, fetched).ret_code != MEMCH_GET_OK)
-        sleep(0.5);
+        if (opcode != IBV_WR_SEND) {
+            work_req.wr.rdma.remote_addr = reinterpret_cast<uintptr_t>(remote_addr);
+            work_req.wr.rdma.rkey = rkey;
+        }
 
-    hartebeest::Qp* remote_qp = new hartebeest::Qp(remote_qp_key, IBV_QPT_RAW_PACKET, 0, 0, 0);
-    remote_qp->unflatten_info(fetched.c_str());
-    remote_qp_cache.register_resrc(remote_qp_key, remote_qp);
+        int ret = ibv_post_send(local_qp, &work_req, &bad_work_req);
 
-    HB_CLOGGER->info("Fetch MEMC: {}, 0x{:x}", fetched, uintptr_t(remote_qp));
+        if (bad_work_req != nullptr) {
+            HB_CLOGGER->warn("Bad work request");
+            return false;
+        }
+        if (ret != 0) {
+            HB_CLOGGER->warn("RDMA Post unusual return: {}", ret);
+            return false;
+        }
 
-    return true;
+        return true;
 }
 
-bool hartebeest::HartebeestCore::rdma_post_single_fast(
-        struct ibv_qp* local_qp, void* local_addr, void* remote_addr, size_t len, 
-        enum ibv_wr_opcode opcode, uint32_t lkey, uint32_t rkey, uint64_t work_id
+// remote_qkey is the receiving QP's, see Qp::get_qkey().
+bool hartebeest::HartebeestCore::rdma_post_ud_send(
+        struct ibv_qp* local_qp, struct ibv_ah* remote_ah, uint32_t remote_qpn, uint32_t remote_qkey, 
+        void* local_addr, size_t len, uint32_t lkey, uint64_t work_id
     ) {
         struct ibv_send_wr work_req;
         struct ibv_sge sg_elem;
@@ -253,14 +1969,14 @@ bool hartebeest::HartebeestCore::rdma_post_single_fast(
 
         work_req.wr_id = work_id;
         work_req.num_sge = 1;
-        work_req.opcode = opcode;
+        work_req.opcode = IBV_WR_SEND;
         work_req.send_flags = IBV_SEND_SIGNALED;
-        work_req.wr_id = 0;
         work_req.sg_list = &sg_elem;
         work_req.next = nullptr;
 
-        work_req.wr.rdma.remote_addr = reinterpret_cast<uintptr_t>(remote_addr);
-        work_req.wr.rdma.rkey = rkey;
+        work_req.wr.ud.ah = remote_ah;
+        work_req.wr.ud.remote_qpn = remote_qpn;
+        work_req.wr.ud.remote_qkey = remote_qkey;
 
         int ret = ibv_post_send(local_qp, &work_req, &bad_work_req);
 
@@ -269,7 +1985,45 @@ bool hartebeest::HartebeestCore::rdma_post_single_fast(
             return false;
         }
         if (ret != 0) {
-            HB_CLOGGER->warn("RDMA Post unusual return: {}", ret);
+            HB_CLOGGER->warn("UD Post unusual return: {}", ret);
+            return false;
+        }
+
+        return true;
+}
+
+// Peers made from the same profile share its Q_Key.
+bool hartebeest::HartebeestCore::rdma_post_ud_send(
+        hartebeest::Qp* local_qp, struct ibv_ah* remote_ah, uint32_t remote_qpn, 
+        void* local_addr, size_t len, uint32_t lkey, uint64_t work_id
+    ) {
+        return rdma_post_ud_send(local_qp->get_qp(), remote_ah, remote_qpn, local_qp->get_qkey(), 
+            local_addr, len, lkey, work_id);
+}
+
+// recv_slot must hold UD_GRH_BYTES + len. The payload lands at ud_payload(recv_slot).
+bool hartebeest::HartebeestCore::rdma_post_ud_recv(
+        struct ibv_qp* local_qp, void* recv_slot, size_t len, uint32_t lkey, uint64_t work_id
+    ) {
+        struct ibv_recv_wr work_req;
+        struct ibv_sge sg_elem;
+        struct ibv_recv_wr* bad_work_req = nullptr;
+
+        std::memset(&sg_elem, 0, sizeof(sg_elem));
+        std::memset(&work_req, 0, sizeof(work_req)); 
+
+        sg_elem.addr = reinterpret_cast<uintptr_t>(recv_slot);
+        sg_elem.length = len + hartebeest::UD_GRH_BYTES;
+        sg_elem.lkey = lkey;
+
+        work_req.wr_id = work_id;
+        work_req.num_sge = 1;
+        work_req.sg_list = &sg_elem;
+        work_req.next = nullptr;
+
+        int ret = ibv_post_recv(local_qp, &work_req, &bad_work_req);
+        if (ret != 0) {
+            HB_CLOGGER->warn("UD Recv post unusual return: {}", ret);
             return false;
         }
 
@@ -376,6 +2130,18 @@ hartebeest::Mr* hartebeest::HartebeestCore::get_local_mr(const char* pd_key, con
     return HB_PD_CACHE.get_resrc(pd_key)->get_mr_cache().get_resrc(mr_key);
 }
 
+hartebeest::Mw* hartebeest::HartebeestCore::get_local_mw(const char* pd_key, const char* mw_key) {
+    return HB_PD_CACHE.get_resrc(pd_key)->get_mw_cache().get_resrc(mw_key);
+}
+
+hartebeest::XrcSrq* hartebeest::HartebeestCore::get_local_xrc_srq(const char* pd_key, const char* srq_key) {
+    return HB_PD_CACHE.get_resrc(pd_key)->get_srq_cache().get_resrc(srq_key);
+}
+
+hartebeest::BasicCq* hartebeest::HartebeestCore::get_local_basiccq(const char* cq_key) {
+    return HB_BASICCQ_CACHE.get_resrc(cq_key);
+}
+
 hartebeest::Qp* hartebeest::HartebeestCore::get_local_qp(const char* pd_key, const char* qp_key) {
     return HB_PD_CACHE.get_resrc(pd_key)->get_qp_cache().get_resrc(qp_key);
 }
@@ -389,6 +2155,14 @@ hartebeest::Qp* hartebeest::HartebeestCore::get_remote_qp(const char* remote_qp_
 }
 
 
+hartebeest::RailSet* hartebeest::HartebeestCore::get_rail_set(const char* set_key) {
+    return rail_set_cache.get_resrc(set_key);
+}
+
+int hartebeest::HartebeestCore::get_n_rails() {
+    return rails.size();
+}
+
 char* hartebeest::HartebeestCore::get_sysvar(const char* envvar) {
     return HB_CFG_LOADER.get_sysvar(envvar);
 }
@@ -3,6 +3,11 @@
  * hb_alloc.cc
  */
 
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
 #include "./includes/hb_alloc.hh"
 
 uint8_t* hartebeest::alloc_buffer(size_t len, int align) {
@@ -12,3 +17,35 @@ uint8_t* hartebeest::alloc_buffer(size_t len, int align) {
 void hartebeest::free_buffer(uint8_t* buf) {
     free(buf);
 }
+
+void hartebeest::prefault_buffer(uint8_t* buf, size_t len, int n_threads) {
+    
+    size_t page_sz = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t n_pages = (len + page_sz - 1) / page_sz;
+
+    if (n_threads <= 0)
+        n_threads = std::thread::hardware_concurrency();
+    if (n_threads <= 0)
+        n_threads = 1;
+    if (static_cast<size_t>(n_threads) > n_pages)
+        n_threads = (n_pages > 0) ? n_pages : 1;
+
+    // Each thread takes a contiguous run of pages.
+    size_t per_thread = (n_pages + n_threads - 1) / n_threads;
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < n_threads; t++) {
+        size_t begin = t * per_thread * page_sz;
+        size_t end = (t + 1) * per_thread * page_sz;
+        if (end > len)
+            end = len;
+
+        workers.push_back(std::thread([buf, begin, end, page_sz]() {
+            for (size_t off = begin; off < end; off += page_sz)
+                reinterpret_cast<volatile uint8_t*>(buf)[off] = 0;
+        }));
+    }
+
+    for (auto& worker: workers)
+        worker.join();
+}
@@ -6,6 +6,8 @@
 #include <fstream>
 #include <cstdlib>
 #include <climits>
+#include <cstring>
+#include <cassert>
 
 #include <iostream>
 
@@ -28,7 +30,9 @@ namespace hartebeest {
 
     const char* pdef_cq_attr_key = "cq_attr";
     struct ConfPair pdef_cq_attr[] = {
-        {"cq_depth",                    128},
+        {"cq_depth",                    128},       // "auto": from the device and qps_per_cq
+        {"qps_per_cq",                  1},         // Expected QPs sharing one CQ
+        {"overflow",                    1},         // Attached WRs over depth, 0: warn, 1: resize, 2: refuse
     };
 
     const char* pdef_qp_init_attr_key = "qp_init_attr";
@@ -60,6 +64,9 @@ namespace hartebeest {
         {"rc:ah_attr.is_global",        0},
         {"rc:ah_attr.sl",               0},
         {"rc:ah_attr.src_path_bits",    0},
+        {"rc:ah_attr.grh.hop_limit",    64},
+        {"rc:ah_attr.grh.traffic_class", 0},
+        {"rc:ah_attr.grh.flow_label",   -1},    // -1: per-QP, spreads over ECMP
         {"rc:max_dest_rd_atomic",       16},
         {"rc:min_rnr_timer",            12},
         {"rc:timeout",                  14},
@@ -74,6 +81,9 @@ namespace hartebeest {
         {"uc:ah_attr.is_global",        0},
         {"uc:ah_attr.sl",               0},
         {"uc:ah_attr.src_path_bits",    0},
+        {"uc:ah_attr.grh.hop_limit",    64},
+        {"uc:ah_attr.grh.traffic_class", 0},
+        {"uc:ah_attr.grh.flow_label",   -1},
         {"uc:max_dest_rd_atomic",       16},
         {"uc:min_rnr_timer",            12},
         {"uc:timeout",                  14},
@@ -88,6 +98,9 @@ namespace hartebeest {
         {"ud:ah_attr.is_global",        0},
         {"ud:ah_attr.sl",               0},
         {"ud:ah_attr.src_path_bits",    0},
+        {"ud:ah_attr.grh.hop_limit",    64},
+        {"ud:ah_attr.grh.traffic_class", 0},
+        {"ud:ah_attr.grh.flow_label",   -1},
         {"ud:max_dest_rd_atomic",       16},
         {"ud:min_rnr_timer",            12},
         {"ud:timeout",                  14},
@@ -95,15 +108,104 @@ namespace hartebeest {
         {"ud:rnr_retry",                7},
         {"ud:max_rd_atomic",            1},
         {"ud:max_dest_rd_atomic",       16},
+        {"ud:qkey",                     0x11111111},
+    };
+
+    const char* pdef_hca_attr_key = "hca_attr";
+    struct ConfPair pdef_hca_attr[] = {
+        {"gid_idx",                     -1},    // -1: discover, RoCE v2 first
+        {"tune.goal",                   0},     // "auto" values, 0: latency, 1: throughput
+    };
+
+    // Every exchanger wait backs off from initial_us to max_us, +-jitter_pct.
+    const char* pdef_exc_attr_key = "exc_attr";
+    struct ConfPair pdef_exc_attr[] = {
+        {"wait.initial_us",             1000},
+        {"wait.max_us",                 200000},
+        {"wait.jitter_pct",             25},
+        {"wait.deadline_ms",            300000},    // 0: wait forever
+        {"wire.binary",                 1},         // 0: ':'-separated text
+        {"barrier.expire_s",            600},       // Counter lifetime, 0: never
+        {"backend.type",                0},         // 0: Memcached, 1: TCP, 2: shared memory
+        {"shm.n_slots",                 4096},
+        {"shm.size_mb",                 64},
+        {"memc.pool_size",              8},         // Handles, one per concurrent caller
+        {"memc.binary",                 1},
+        {"memc.tcp_nodelay",            1},
+        {"memc.no_block",               1},
+        {"memc.noreply",                0},         // Sets do not wait for the server
+        {"tree.group_size",             0},         // connect_all() through group leaders, 0: flat
+        {"key.expire_s",                0},         // Record lifetime, 0: never
+        {"epoch.auto",                  0},         // Agree on a run epoch without HARTEBEEST_EPOCH
     };
 
     struct ConfDict pdef_cfs[] = {
         {pdef_cq_attr_key, ARRSZ(pdef_cq_attr, ConfPair), pdef_cq_attr},
         {pdef_qp_init_attr_key, ARRSZ(pdef_qp_init_attr, ConfPair), pdef_qp_init_attr},
-        {pdef_qp_attr_key, ARRSZ(pdef_qp_attr, ConfPair), pdef_qp_attr}
+        {pdef_qp_attr_key, ARRSZ(pdef_qp_attr, ConfPair), pdef_qp_attr},
+        {pdef_hca_attr_key, ARRSZ(pdef_hca_attr, ConfPair), pdef_hca_attr},
+        {pdef_exc_attr_key, ARRSZ(pdef_exc_attr, ConfPair), pdef_exc_attr}
     };
 }
 
+namespace hartebeest {
+    int find_qp_pdef(const std::string& key) {
+        for (auto& pair: pdef_qp_init_attr)
+            if (key == pair.key)
+                return pair.val;
+
+        for (auto& pair: pdef_qp_attr)
+            if (key == pair.key)
+                return pair.val;
+
+        assert(false);
+        return 0;
+    }
+
+    bool is_qp_pdef(const std::string& key) {
+        for (auto& pair: pdef_qp_init_attr)
+            if (key == pair.key)
+                return true;
+
+        for (auto& pair: pdef_qp_attr)
+            if (key == pair.key)
+                return true;
+
+        return false;
+    }
+
+    bool is_auto_attr(const std::string& key) {
+        const char* auto_keys[] = {
+            "cq_depth", "cap.max_send_wr", "cap.max_recv_wr", 
+            "cap.max_send_sge", "cap.max_recv_sge", "cap.max_inline_data" 
+        };
+
+        for (auto auto_key: auto_keys) {
+            std::string suffix(auto_key);
+            if (key.size() >= suffix.size() && 
+                key.compare(key.size() - suffix.size(), suffix.size(), suffix) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // A number, or "auto" where is_auto_attr() allows it. Otherwise throws.
+    int parse_attr(const std::string& key, const nlohmann::json& val) {
+        if (val.is_string() && val.get<std::string>() == "auto" && is_auto_attr(key))
+            return ATTR_AUTO;
+
+        return val.get<int>();
+    }
+
+    int qp_profile_idx(enum ibv_qp_type connect_type) {
+        switch (connect_type) {
+        case IBV_QPT_UC:    return QP_PROFILE_UC;
+        case IBV_QPT_UD:    return QP_PROFILE_UD;
+        default:            return QP_PROFILE_RC;
+        }
+    }
+}
+
 bool hartebeest::ConfigLoader::is_attr_cached(const char* key) {
     return (attr_cache.find(key) != attr_cache.end());
 }
@@ -115,6 +217,63 @@ bool hartebeest::ConfigLoader::is_sysvar_cached(const char* key) {
 
 hartebeest::ConfigLoader::ConfigLoader(const char* path) {
     fname = std::string(path);
+
+    // Usable before init_params(), with the built-in defaults.
+    compile_qp_profiles(std::map<std::string, int>(), default_profiles);
+}
+
+// Overrides are flat "<rc|uc|ud>:<key>" pairs on top of the current values.
+void hartebeest::ConfigLoader::compile_qp_profiles(
+        const std::map<std::string, int>& overrides, hartebeest::QpProfileSet& profiles
+    ) {
+    const char* prefixes[QP_PROFILE_N] = { "rc:", "uc:", "ud:" };
+
+    for (int idx = 0; idx < QP_PROFILE_N; idx++) {
+        struct QpProfile& profile = profiles.transport[idx];
+        std::string prefix(prefixes[idx]);
+
+        auto value = [&](const char* key) {
+            auto it = overrides.find(prefix + key);
+            return (it != overrides.end()) ? it->second : find_qp_pdef(prefix + key);
+        };
+
+        auto cap_value = [&](const char* key, uint32_t auto_bit) {
+            int val = value(key);
+            if (val != ATTR_AUTO)
+                return static_cast<uint32_t>(val);
+
+            profile.auto_mask |= auto_bit;
+            return static_cast<uint32_t>(0);
+        };
+
+        std::memset(&profile, 0, sizeof(struct QpProfile));
+
+        profile.cap.max_send_wr = cap_value("cap.max_send_wr", QP_AUTO_SEND_WR);
+        profile.cap.max_recv_wr = cap_value("cap.max_recv_wr", QP_AUTO_RECV_WR);
+        profile.cap.max_send_sge = cap_value("cap.max_send_sge", QP_AUTO_SEND_SGE);
+        profile.cap.max_recv_sge = cap_value("cap.max_recv_sge", QP_AUTO_RECV_SGE);
+        profile.cap.max_inline_data = cap_value("cap.max_inline_data", QP_AUTO_INLINE);
+
+        profile.path_mtu = static_cast<enum ibv_mtu>(value("path_mtu"));
+        profile.rq_psn = value("rq_psn");
+        profile.sq_psn = value("sq_psn");
+
+        profile.is_global = value("ah_attr.is_global");
+        profile.sl = value("ah_attr.sl");
+        profile.src_path_bits = value("ah_attr.src_path_bits");
+        profile.hop_limit = value("ah_attr.grh.hop_limit");
+        profile.traffic_class = value("ah_attr.grh.traffic_class");
+        profile.flow_label = value("ah_attr.grh.flow_label");
+
+        profile.max_dest_rd_atomic = value("max_dest_rd_atomic");
+        profile.min_rnr_timer = value("min_rnr_timer");
+        profile.timeout = value("timeout");
+        profile.retry_cnt = value("retry_cnt");
+        profile.rnr_retry = value("rnr_retry");
+        profile.max_rd_atomic = value("max_rd_atomic");
+
+        profile.qkey = (idx == QP_PROFILE_UD) ? value("qkey") : 0;
+    }
 }
 
 hb_retcode hartebeest::ConfigLoader::init_sysvars() {
@@ -161,17 +320,17 @@ hb_retcode hartebeest::ConfigLoader::init_params() {
         for (int i = 0; i < n_attr; i++) {
             attr = &pdef_cfs[i];
 
-            if (!cfgs.contains(attr->key)) {
-                HB_CLOGGER->info("Skipping paramter: {}", attr->key);
-                continue;
-            }
+            // A dict not in the file keeps its defaults, still registered.
+            bool in_file = cfgs.contains(attr->key);
+            if (!in_file)
+                HB_CLOGGER->info("Skipping paramter: {}, defaults kept", attr->key);
 
-            nlohmann::json& sub_cfgs = cfgs[attr->key];
+            nlohmann::json sub_cfgs = in_file ? cfgs[attr->key] : nlohmann::json::object();
             
             for (int j = 0; j < attr->n_elem; j++) {
                 const char* key = attr->conf[j].key;
                 if (sub_cfgs.contains(key)) {
-                    attr->conf[j].val = sub_cfgs[key];
+                    attr->conf[j].val = parse_attr(key, sub_cfgs[key]);
                     HB_CLOGGER->info("Substitute: {}, [{}, {}]", attr->key, key, attr->conf[j].val);
                 }
 
@@ -184,6 +343,26 @@ hb_retcode hartebeest::ConfigLoader::init_params() {
             }
         }
 
+        compile_qp_profiles(std::map<std::string, int>(), default_profiles);
+
+        // Named profiles override the keys they list, the rest follows the defaults.
+        if (cfgs.contains("qp_profiles")) {
+            for (auto& named: cfgs["qp_profiles"].items()) {
+                std::map<std::string, int> overrides;
+
+                for (auto& pair: named.value().items()) {
+                    if (!is_qp_pdef(pair.key())) {
+                        HB_CLOGGER->warn("QP profile {}: unknown key {}, skipped", named.key(), pair.key());
+                        continue;
+                    }
+                    overrides[pair.key()] = parse_attr(pair.key(), pair.value());
+                }
+
+                compile_qp_profiles(overrides, qp_profiles[named.key()]);
+                HB_CLOGGER->info("QP profile {}: {} overrides", named.key(), overrides.size());
+            }
+        }
+
     } catch (...) {
         return hb_retcode(CFGLDR_JSON_ERR);
     }
@@ -201,6 +380,22 @@ char* hartebeest::ConfigLoader::get_sysvar(const char* envvar) {
     return sysvar_cache.find(envvar)->second;
 }
 
+// Without a name, or with an unknown one, the default profile.
+const hartebeest::QpProfile* hartebeest::ConfigLoader::get_qp_profile(enum ibv_qp_type connect_type, const char* name) {
+
+    int idx = qp_profile_idx(connect_type);
+    if (name == nullptr)
+        return &default_profiles.transport[idx];
+
+    auto it = qp_profiles.find(name);
+    if (it == qp_profiles.end()) {
+        HB_CLOGGER->warn("QP profile {} not found, default used", name);
+        return &default_profiles.transport[idx];
+    }
+
+    return &it->second.transport[idx];
+}
+
 int* hartebeest::ConfigLoader::get_attr(const char* attr_key) {
     
     const char* val = nullptr;
@@ -4,7 +4,11 @@
  */
 
 #include <string>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <mutex>
 
 #include <infiniband/verbs.h>
 
@@ -14,27 +18,176 @@
 #include "./includes/hb_cfgldr.hh"
 #include "./includes/hb_cqs.hh"
 
+namespace hartebeest {
+    int get_cq_depth(hartebeest::Hca& hca_dev) {
+        int* cq_depth = HB_CFG_LOADER.get_attr("cq_depth");
+        assert(cq_depth != nullptr);
+
+        return (*cq_depth == ATTR_AUTO) ? hca_dev.tune_cq_depth() : *cq_depth;
+    }
+
+    // cq_context belongs to whoever made the CQ, so it cannot tell ours apart.
+    std::mutex cq_registry_mtx;
+    std::map<struct ibv_cq*, BasicCq*> cq_registry;
+
+    void register_cq(struct ibv_cq* verbs_cq, BasicCq* basic_cq) {
+        if (verbs_cq == nullptr)
+            return;
+
+        std::lock_guard<std::mutex> guard(cq_registry_mtx);
+        cq_registry[verbs_cq] = basic_cq;
+    }
+
+    void deregister_cq(struct ibv_cq* verbs_cq) {
+        std::lock_guard<std::mutex> guard(cq_registry_mtx);
+        cq_registry.erase(verbs_cq);
+    }
+}
+
 hartebeest::BasicCq::BasicCq(const char* name, hartebeest::Hca& hca_dev) {
     hca_ln = &hca_dev;
+    this->name = std::string(name);
 
     struct ibv_context* hca_ctx = hca_dev.get_device_ctx();
     // int* cq_depth = ConfigLoader::get_instance().get_attr("cq_depth");
     
-    int* cq_depth = HB_CFG_LOADER.get_attr("cq_depth");
-    assert(cq_depth != nullptr);
-    
-    cq = ibv_create_cq(hca_ctx, *cq_depth, nullptr, nullptr, 0);
+    cq = ibv_create_cq(hca_ctx, get_cq_depth(hca_dev), this, nullptr, 0);
+    register_cq(cq, this);
+}
+
+// Single-threaded CQ under a parent domain; the provider skips its locks.
+hartebeest::BasicCq::BasicCq(const char* name, hartebeest::Hca& hca_dev, struct ibv_pd* parent_pd) {
+    hca_ln = &hca_dev;
+    this->name = std::string(name);
+
+    struct ibv_cq_init_attr_ex cq_attr;
+    std::memset(&cq_attr, 0, sizeof(cq_attr));
+
+    cq_attr.cqe = get_cq_depth(hca_dev);
+    cq_attr.cq_context = this;
+    cq_attr.wc_flags = IBV_WC_STANDARD_FLAGS;
+    cq_attr.comp_mask = IBV_CQ_INIT_ATTR_MASK_FLAGS | IBV_CQ_INIT_ATTR_MASK_PD;
+    cq_attr.flags = IBV_CREATE_CQ_ATTR_SINGLE_THREADED;
+    cq_attr.parent_domain = parent_pd;
+
+    struct ibv_cq_ex* cq_ex = ibv_create_cq_ex(hca_dev.get_device_ctx(), &cq_attr);
+    if (cq_ex != nullptr)
+        cq = ibv_cq_ex_to_cq(cq_ex);
+
+    register_cq(cq, this);
 }
 
 hartebeest::BasicCq::~BasicCq() {
-    if (cq != nullptr)
+    if (cq != nullptr) {
+        report_usage();
+        deregister_cq(cq);
         ibv_destroy_cq(cq);
+    }
 }
 
 struct ibv_cq* hartebeest::BasicCq::get_cq() {
     return cq;
 }
 
+const char* hartebeest::BasicCq::get_name() const {
+    return name.c_str();
+}
+
+// nullptr for a CQ that was not made by a BasicCq.
+hartebeest::BasicCq* hartebeest::BasicCq::of(struct ibv_cq* verbs_cq) {
+    if (verbs_cq == nullptr)
+        return nullptr;
+
+    std::lock_guard<std::mutex> guard(cq_registry_mtx);
+
+    auto found = cq_registry.find(verbs_cq);
+    return (found != cq_registry.end()) ? found->second : nullptr;
+}
+
+// At least doubles, so a run of attaches resizes only a few times.
+bool hartebeest::BasicCq::grow(uint64_t demand) {
+
+    uint64_t max_cqe = static_cast<uint64_t>(hca_ln->get_device_attr().max_cqe);
+    if (demand > max_cqe)
+        return false;
+
+    uint64_t new_depth = std::min(max_cqe, std::max(demand, 2 * static_cast<uint64_t>(cq->cqe)));
+    int old_depth = cq->cqe;
+
+    if (ibv_resize_cq(cq, static_cast<int>(new_depth)) != 0)
+        return false;
+
+    n_resized++;
+    HB_CLOGGER->info("CQ({}) resized: {} -> {} for {} WRs of {} QPs", name, old_depth, cq->cqe, demand, n_attached + 1);
+
+    return true;
+}
+
+// cq_attr overflow decides what happens when the WRs would not fit.
+hb_retcode hartebeest::BasicCq::attach(uint32_t n_wrs) {
+
+    std::lock_guard<std::mutex> guard(attach_mtx);
+
+    uint64_t demand = attached_wrs + n_wrs;
+
+    if (demand > static_cast<uint64_t>(cq->cqe)) {
+        int* overflow = HB_CFG_LOADER.get_attr("overflow");
+        int policy = (overflow != nullptr) ? *overflow : CQ_OVERFLOW_RESIZE;
+
+        if (policy == CQ_OVERFLOW_REFUSE || (policy == CQ_OVERFLOW_RESIZE && !grow(demand))) {
+            HB_CLOGGER->warn("CQ({}) refused {} WRs: {} of {} attached", name, n_wrs, attached_wrs, cq->cqe);
+            return hb_retcode(CQ_RETCODE_ATTACH_ERR);
+        }
+
+        if (policy == CQ_OVERFLOW_WARN)
+            HB_CLOGGER->warn("CQ({}) overcommitted: {} WRs on {} entries", name, demand, cq->cqe);
+    }
+
+    n_attached++;
+    attached_wrs = demand;
+    peak_attached_wrs = std::max(peak_attached_wrs, attached_wrs);
+
+    return hb_retcode(CQ_RETCODE_ATTACH_OK);
+}
+
+// The CQ keeps its size. A later attach has the room.
+void hartebeest::BasicCq::detach(uint32_t n_wrs) {
+
+    std::lock_guard<std::mutex> guard(attach_mtx);
+
+    assert(n_attached > 0 && attached_wrs >= n_wrs);
+
+    n_attached--;
+    attached_wrs -= n_wrs;
+}
+
+int hartebeest::BasicCq::get_depth() {
+    return cq->cqe;
+}
+
+int hartebeest::BasicCq::get_n_attached() {
+    std::lock_guard<std::mutex> guard(attach_mtx);
+    return n_attached;
+}
+
+uint64_t hartebeest::BasicCq::get_attached_wrs() {
+    std::lock_guard<std::mutex> guard(attach_mtx);
+    return attached_wrs;
+}
+
+uint64_t hartebeest::BasicCq::get_peak_attached_wrs() {
+    std::lock_guard<std::mutex> guard(attach_mtx);
+    return peak_attached_wrs;
+}
+
+void hartebeest::BasicCq::report_usage() {
+    std::lock_guard<std::mutex> guard(attach_mtx);
+
+    HB_CLOGGER->info("CQ({}) usage: {} QPs, {} WRs attached, peak {} of {} entries ({}%), {} resizes",
+        name, n_attached, attached_wrs, peak_attached_wrs, cq->cqe, 
+        (cq->cqe > 0) ? (100 * peak_attached_wrs / cq->cqe) : 0, n_resized);
+}
+
 hartebeest::BasicCqCache::BasicCqCache(const char* name) : ResourceCache<BasicCq>(name) {
     
 }
@@ -0,0 +1,145 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_dir.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <algorithm>
+
+#include "./includes/hb_logger.hh"
+#include "./includes/hb_dir.hh"
+
+namespace hartebeest {
+
+    // Both sides must land on the same slot.
+    size_t dir_home(const std::string& key, size_t n_entries) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (auto c: key) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash % n_entries;
+    }
+}
+
+hartebeest::Directory::Directory(uint8_t* region, size_t inbox_slots, size_t entries) :
+    base(region), n_inbox(inbox_slots), n_entries(entries) {
+
+    static_assert(sizeof(DirEntry) == 512, "DirEntry is meant to be 512 bytes");
+    std::memset(base, 0, region_size(n_inbox, n_entries));
+}
+
+size_t hartebeest::Directory::region_size(size_t inbox_slots, size_t entries) {
+    return inbox_slots * sizeof(uint64_t) + entries * sizeof(DirEntry);
+}
+
+size_t hartebeest::Directory::get_entries_offset() const {
+    return n_inbox * sizeof(uint64_t);
+}
+
+size_t hartebeest::Directory::get_entries_size() const {
+    return n_entries * sizeof(DirEntry);
+}
+
+size_t hartebeest::Directory::get_n_entries() const {
+    return n_entries;
+}
+
+volatile uint64_t* hartebeest::Directory::inbox(size_t idx) {
+    assert(idx < n_inbox);
+    return reinterpret_cast<volatile uint64_t*>(base) + idx;
+}
+
+// Linear probing from the key's home slot. Entries are never removed.
+bool hartebeest::Directory::publish(const std::string& key, const std::string& value) {
+
+    if (key.size() > DIR_KEY_MAX || value.size() > DIR_VALUE_MAX)
+        return false;
+
+    DirEntry* entries = reinterpret_cast<DirEntry*>(base + get_entries_offset());
+    size_t home = dir_home(key, n_entries);
+
+    for (size_t probe = 0; probe < n_entries; probe++) {
+        DirEntry* entry = &entries[(home + probe) % n_entries];
+
+        bool is_empty = (entry->seq_end == 0);
+        if (!is_empty && (entry->key_len != key.size() || std::memcmp(entry->key, key.data(), key.size()) != 0))
+            continue;
+
+        uint64_t seq = entry->seq_end;
+
+        // An odd seq_end marks the entry torn before any field changes, and
+        // seq_end turns even again only after seq_begin has the new number.
+        entry->seq_end = seq + 1;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        entry->key_len = key.size();
+        entry->value_len = value.size();
+        std::memcpy(entry->key, key.data(), key.size());
+        std::memcpy(entry->value, value.data(), value.size());
+
+        std::atomic_thread_fence(std::memory_order_release);
+        entry->seq_begin = seq + 2;
+        std::atomic_thread_fence(std::memory_order_release);
+        entry->seq_end = seq + 2;
+
+        return true;
+    }
+
+    HB_CLOGGER->warn("Directory is full, {} not published", key);
+    return false;
+}
+
+// Owner side, in its own table. The owner is the only writer.
+bool hartebeest::Directory::lookup(const std::string& key, std::string& value) {
+
+    const uint8_t* entries = base + get_entries_offset();
+    size_t slot = dir_home(key, n_entries);
+
+    for (size_t n_probed = 0; n_probed < n_entries; ) {
+        size_t n_window = std::min(n_entries - slot, n_entries - n_probed);
+
+        enum DirFind found = find(entries + slot * sizeof(DirEntry), n_window, key, value);
+        if (found != DIR_PROBE_ON)
+            return (found == DIR_FOUND);
+
+        n_probed += n_window;
+        slot = 0;
+    }
+
+    return false;
+}
+
+size_t hartebeest::Directory::home(const std::string& key, size_t entries) {
+    return dir_home(key, entries);
+}
+
+// The copy starts somewhere in the key's probe run and does not wrap; the
+// caller reads the next entries on DIR_PROBE_ON. Probing stops at the
+// first never-written entry, like publish() does.
+enum hartebeest::DirFind hartebeest::Directory::find(
+        const uint8_t* snapshot, size_t n_copied, const std::string& key, std::string& value
+    ) {
+
+    const DirEntry* table = reinterpret_cast<const DirEntry*>(snapshot);
+
+    for (size_t probe = 0; probe < n_copied; probe++) {
+        const DirEntry* entry = &table[probe];
+
+        if (entry->seq_begin != entry->seq_end || (entry->seq_end & 1))
+            return DIR_TORN;
+
+        if (entry->seq_end == 0)
+            return DIR_NOT_FOUND;
+
+        if (entry->key_len == key.size() && std::memcmp(entry->key, key.data(), key.size()) == 0) {
+            value.assign(reinterpret_cast<const char*>(entry->value), entry->value_len);
+            return DIR_FOUND;
+        }
+    }
+
+    return DIR_PROBE_ON;
+}
@@ -0,0 +1,213 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_endpoint.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./includes/hb_retcode.hh"
+#include "./includes/hb_logger.hh"
+
+#include "./includes/hb_endpoint.hh"
+
+hartebeest::Endpoint::Endpoint(
+        const char* key, hartebeest::Hca& hca_dev, int n_peers, size_t buflen,
+        enum ibv_qp_type conn_type, bool thread_bound
+    ) {
+    name = std::string(key);
+
+    pd = new hartebeest::Pd((name + "-pd").c_str(), hca_dev);
+
+    // Without a thread domain it still works, only with the provider's locks.
+    if (thread_bound &&
+        pd->bind_thread_domain().ret_code == PD_RETCODE_ALLOC_TD_OK) {
+        cq = new hartebeest::BasicCq((name + "-cq").c_str(), hca_dev, pd->get_qp_pd());
+    }
+    else
+        cq = new hartebeest::BasicCq((name + "-cq").c_str(), hca_dev);
+
+    if (cq->get_cq() == nullptr) {
+        HB_CLOGGER->warn("Endpoint {}: CQ not created", name);
+        return;
+    }
+
+    int rights = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE;
+
+    send_mr = new hartebeest::Mr((name + "-send").c_str(), buflen);
+    send_mr->set_mr(ibv_reg_mr(pd->get_pd(), send_mr->get_buffer(), buflen, rights));
+
+    recv_mr = new hartebeest::Mr((name + "-recv").c_str(), buflen);
+    recv_mr->set_mr(ibv_reg_mr(pd->get_pd(), recv_mr->get_buffer(), buflen, rights));
+
+    if (!send_mr->is_mr_created() || !recv_mr->is_mr_created()) {
+        HB_CLOGGER->warn("Endpoint {}: buffers not registered", name);
+        return;
+    }
+
+    // Remote slots first, the destructor walks them whatever happens below.
+    remote_qps.assign(n_peers, nullptr);
+    remote_mrs.assign(n_peers, nullptr);
+
+    for (int peer = 0; peer < n_peers; peer++) {
+        std::string qp_key = name + "-qp-" + std::to_string(peer);
+
+        hartebeest::Qp* qp = new hartebeest::Qp(qp_key.c_str(), conn_type, pd, cq->get_cq(), cq->get_cq());
+        if (!qp->is_qp_created() || qp->transit_init().ret_code != QP_TRANSITION_2_INIT_OK) {
+            HB_CLOGGER->warn("Endpoint {}: QP for peer {} not ready", name, peer);
+            delete qp;
+            return;
+        }
+
+        qps.push_back(qp);
+    }
+
+    ready = true;
+
+    HB_CLOGGER->info("New endpoint {}: {} peers, {} bytes buffers, thread bound: {}",
+        name, n_peers, buflen, pd->is_thread_bound());
+}
+
+hartebeest::Endpoint::~Endpoint() {
+    for (auto qp: qps)
+        delete qp;
+
+    for (auto qp: remote_qps)
+        delete qp;
+
+    for (auto mr: remote_mrs)
+        delete mr;
+
+    delete send_mr;
+    delete recv_mr;
+    delete cq;
+    delete pd;
+}
+
+// False if any resource failed to come up. Such an endpoint is only deleted.
+bool hartebeest::Endpoint::is_ready() const {
+    return ready;
+}
+
+const char* hartebeest::Endpoint::get_name() const {
+    return name.c_str();
+}
+
+int hartebeest::Endpoint::get_n_peers() const {
+    return qps.size();
+}
+
+hartebeest::Pd* hartebeest::Endpoint::get_pd() {
+    return pd;
+}
+
+hartebeest::Qp* hartebeest::Endpoint::get_qp(int peer) {
+    return qps.at(peer);
+}
+
+struct ibv_cq* hartebeest::Endpoint::get_cq() {
+    return cq->get_cq();
+}
+
+hartebeest::Mr* hartebeest::Endpoint::get_send_mr() {
+    return send_mr;
+}
+
+hartebeest::Mr* hartebeest::Endpoint::get_recv_mr() {
+    return recv_mr;
+}
+
+// Takes ownership of the remote containers.
+hb_retcode hartebeest::Endpoint::connect(int peer, hartebeest::Qp* remote_qp, hartebeest::Mr* remote_mr) {
+
+    assert(remote_qp != nullptr);
+
+    hartebeest::Qp* local_qp = qps.at(peer);
+
+    hb_retcode ret = local_qp->transit_rtr(remote_qp);
+    if (ret.ret_code != QP_TRANSITION_2_RTR_OK)
+        return ret;
+
+    ret = local_qp->transit_rts();
+    if (ret.ret_code != QP_TRANSITION_2_RTS_OK)
+        return ret;
+
+    remote_qps[peer] = remote_qp;
+    remote_mrs[peer] = remote_mr;
+
+    return ret;
+}
+
+bool hartebeest::Endpoint::post_one(
+        int peer, enum ibv_wr_opcode opcode, size_t local_off, size_t remote_off, size_t len, bool signaled
+    ) {
+    struct ibv_send_wr work_req;
+    struct ibv_sge sg_elem;
+    struct ibv_send_wr* bad_work_req = nullptr;
+
+    std::memset(&sg_elem, 0, sizeof(sg_elem));
+    std::memset(&work_req, 0, sizeof(work_req));
+
+    // Reads land in the recv buffer, everything else leaves from the send buffer.
+    hartebeest::Mr* local_mr = (opcode == IBV_WR_RDMA_READ) ? recv_mr : send_mr;
+
+    sg_elem.addr = reinterpret_cast<uintptr_t>(local_mr->get_buffer()) + local_off;
+    sg_elem.length = len;
+    sg_elem.lkey = local_mr->get_mr()->lkey;
+
+    work_req.wr_id = peer;
+    work_req.num_sge = 1;
+    work_req.opcode = opcode;
+    work_req.send_flags = signaled ? IBV_SEND_SIGNALED : 0;
+    work_req.sg_list = &sg_elem;
+    work_req.next = nullptr;
+
+    if (opcode != IBV_WR_SEND) {
+        hartebeest::Mr* remote_mr = remote_mrs[peer];
+
+        work_req.wr.rdma.remote_addr = reinterpret_cast<uintptr_t>(remote_mr->get_mr()->addr) + remote_off;
+        work_req.wr.rdma.rkey = remote_mr->get_mr()->rkey;
+    }
+
+    return (ibv_post_send(qps[peer]->get_qp(), &work_req, &bad_work_req) == 0);
+}
+
+bool hartebeest::Endpoint::post_write(int peer, size_t local_off, size_t remote_off, size_t len, bool signaled) {
+    return post_one(peer, IBV_WR_RDMA_WRITE, local_off, remote_off, len, signaled);
+}
+
+bool hartebeest::Endpoint::post_read(int peer, size_t local_off, size_t remote_off, size_t len, bool signaled) {
+    return post_one(peer, IBV_WR_RDMA_READ, local_off, remote_off, len, signaled);
+}
+
+bool hartebeest::Endpoint::post_send(int peer, size_t local_off, size_t len, bool signaled) {
+    return post_one(peer, IBV_WR_SEND, local_off, 0, len, signaled);
+}
+
+bool hartebeest::Endpoint::post_recv(int peer, size_t local_off, size_t len) {
+    struct ibv_recv_wr work_req;
+    struct ibv_sge sg_elem;
+    struct ibv_recv_wr* bad_work_req = nullptr;
+
+    std::memset(&sg_elem, 0, sizeof(sg_elem));
+    std::memset(&work_req, 0, sizeof(work_req));
+
+    sg_elem.addr = reinterpret_cast<uintptr_t>(recv_mr->get_buffer()) + local_off;
+    sg_elem.length = len;
+    sg_elem.lkey = recv_mr->get_mr()->lkey;
+
+    work_req.wr_id = peer;
+    work_req.num_sge = 1;
+    work_req.sg_list = &sg_elem;
+    work_req.next = nullptr;
+
+    return (ibv_post_recv(qps[peer]->get_qp(), &work_req, &bad_work_req) == 0);
+}
+
+// Completions carry the peer index in wr_id.
+int hartebeest::Endpoint::poll(int max_wcs, struct ibv_wc* wcs) {
+    return ibv_poll_cq(cq->get_cq(), max_wcs, wcs);
+}
@@ -0,0 +1,267 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_exc_shm.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "./includes/hb_logger.hh"
+#include "./includes/hb_exc_shm.hh"
+
+namespace hartebeest {
+
+    const size_t SHM_HEADER_BYTES = 64;
+
+    // Same in every process, unlike std::hash.
+    uint64_t shm_hash(const char* key, size_t len) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t idx = 0; idx < len; idx++) {
+            hash ^= static_cast<uint8_t>(key[idx]);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // Not FUTEX_PRIVATE: waiters live in other processes.
+    long shm_futex(std::atomic<uint32_t>* word, int op, uint32_t val, const struct timespec* timeout) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, val, timeout, nullptr, 0);
+    }
+}
+
+hartebeest::ShmHandle::ShmHandle(const std::string& port) {
+
+    static_assert(sizeof(ShmHeader) <= SHM_HEADER_BYTES, "ShmHeader outgrew its room");
+
+    seg_name = "/hartebeest-" + port;
+
+    n_slots = get_exc_attr("shm.n_slots", 4096);
+    data_cap = static_cast<size_t>(get_exc_attr("shm.size_mb", 64)) << 20;
+    seg_size = SHM_HEADER_BYTES + n_slots * sizeof(ShmSlot) + data_cap;
+
+    int fd = ::shm_open(seg_name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        HB_CLOGGER->warn("Shared memory exchanger: cannot open {}: {}", seg_name, std::strerror(errno));
+        assert(fd >= 0);
+    }
+
+    // Whoever comes first sizes it. The rest must agree on the layout.
+    struct stat seg_stat;
+    if (::fstat(fd, &seg_stat) == 0 && static_cast<size_t>(seg_stat.st_size) < seg_size) {
+        int ret = ::ftruncate(fd, seg_size);
+        assert(ret == 0);
+    }
+
+    void* mapped = ::mmap(nullptr, seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    assert(mapped != MAP_FAILED);
+
+    seg = reinterpret_cast<uint8_t*>(mapped);
+    header = reinterpret_cast<ShmHeader*>(seg);
+    slots = reinterpret_cast<ShmSlot*>(seg + SHM_HEADER_BYTES);
+    data = seg + SHM_HEADER_BYTES + n_slots * sizeof(ShmSlot);
+
+    uint32_t n_attached = header->n_attached.fetch_add(1) + 1;
+
+    HB_CLOGGER->info("Shared memory exchanger: {}, {} slots, {} MB, {} attached",
+        seg_name, n_slots, data_cap >> 20, n_attached);
+}
+
+hartebeest::ShmHandle::~ShmHandle() {
+
+    if (seg == nullptr)
+        return;
+
+    if (header->n_attached.fetch_sub(1) == 1)
+        ::shm_unlink(seg_name.c_str());
+
+    ::munmap(seg, seg_size);
+}
+
+// Linear probing. With create set, claims an empty slot for the key.
+hartebeest::ShmSlot* hartebeest::ShmHandle::find_slot(const char* key, bool create) {
+
+    size_t key_len = std::strlen(key);
+    if (key_len > SHM_KEY_MAX)
+        return nullptr;
+
+    size_t start = shm_hash(key, key_len) % n_slots;
+
+    for (size_t probe = 0; probe < n_slots; probe++) {
+        ShmSlot* slot = &slots[(start + probe) % n_slots];
+        uint32_t state = slot->state.load(std::memory_order_acquire);
+
+        if (state == SHM_SLOT_EMPTY) {
+            if (!create)
+                return nullptr;
+
+            uint32_t expected = SHM_SLOT_EMPTY;
+            if (slot->state.compare_exchange_strong(expected, SHM_SLOT_CLAIMED)) {
+                slot->key_len = key_len;
+                std::memcpy(slot->key, key, key_len);
+                slot->state.store(SHM_SLOT_READY, std::memory_order_release);
+
+                return slot;
+            }
+            state = expected;
+        }
+
+        // Someone is writing the key. It is there in a moment.
+        while (state == SHM_SLOT_CLAIMED)
+            state = slot->state.load(std::memory_order_acquire);
+
+        if (slot->key_len == key_len && std::memcmp(slot->key, key, key_len) == 0)
+            return slot;
+    }
+
+    return nullptr;
+}
+
+bool hartebeest::ShmHandle::append_value(const std::string& val, uint64_t& desc) {
+
+    uint64_t offset = header->data_used.fetch_add(val.size());
+    if (offset + val.size() > data_cap) {
+        HB_CLOGGER->warn("Shared memory exchanger: {} is full", seg_name);
+        return false;
+    }
+
+    std::memcpy(data + offset, val.data(), val.size());
+    desc = ((offset + 1) << 32) | val.size();
+
+    return true;
+}
+
+void hartebeest::ShmHandle::read_value(uint64_t desc, std::string& result) {
+    uint64_t offset = (desc >> 32) - 1;
+    result.assign(reinterpret_cast<const char*>(data + offset), desc & 0xffffffffULL);
+}
+
+void hartebeest::ShmHandle::publish() {
+    header->seq.fetch_add(1, std::memory_order_release);
+    shm_futex(&header->seq, FUTEX_WAKE, INT32_MAX, nullptr);
+}
+
+// Nothing expires here, the segment goes away with the last process.
+hb_retcode hartebeest::ShmHandle::set(const char* key, const std::string& val, time_t expire) {
+
+    ShmSlot* slot = find_slot(key, true);
+    uint64_t desc;
+
+    if (slot == nullptr || !append_value(val, desc)) {
+        HB_CLOGGER->warn("Shared memory exchanger SET <{}, {} bytes> failed", key, val.size());
+        return hb_retcode(MEMCH_SET_ERR);
+    }
+
+    slot->value.store(desc, std::memory_order_release);
+    publish();
+
+    return hb_retcode(MEMCH_SET_OK);
+}
+
+hb_retcode hartebeest::ShmHandle::get(const char* key, std::string& result) {
+
+    ShmSlot* slot = find_slot(key, false);
+    if (slot == nullptr)
+        return hb_retcode(MEMCH_GET_ERR);
+
+    uint64_t desc = slot->value.load(std::memory_order_acquire);
+    if (desc == 0)
+        return hb_retcode(MEMCH_GET_ERR);
+
+    read_value(desc, result);
+    return hb_retcode(MEMCH_GET_OK);
+}
+
+hb_retcode hartebeest::ShmHandle::del(const char* key) {
+
+    ShmSlot* slot = find_slot(key, false);
+    if (slot == nullptr || slot->value.exchange(0) == 0) {
+        HB_CLOGGER->warn("Shared memory exchanger DELETE <{}, ?> failed", key);
+        return hb_retcode(MEMCH_DEL_ERR);
+    }
+
+    return hb_retcode(MEMCH_DEL_OK);
+}
+
+hb_retcode hartebeest::ShmHandle::incr(const char* key, uint64_t delta, time_t expire, uint64_t& value) {
+
+    ShmSlot* slot = find_slot(key, true);
+    if (slot == nullptr)
+        return hb_retcode(MEMCH_INCR_ERR);
+
+    uint64_t old_desc = slot->value.load(std::memory_order_acquire);
+
+    while (true) {
+        std::string counter{"0"};
+        if (old_desc != 0)
+            read_value(old_desc, counter);
+
+        // Like memcached, a value that is not a counter is an error.
+        char* end = nullptr;
+        errno = 0;
+        value = std::strtoull(counter.c_str(), &end, 10);
+
+        if (!std::isdigit(static_cast<unsigned char>(counter[0])) || *end != '\0' || errno == ERANGE) {
+            HB_CLOGGER->warn("Shared memory exchanger INCR <{}>: not a counter", key);
+            return hb_retcode(MEMCH_INCR_ERR);
+        }
+
+        value += delta;
+        if (delta == 0 && old_desc != 0)
+            return hb_retcode(MEMCH_INCR_OK);
+
+        uint64_t new_desc;
+        if (!append_value(std::to_string(value), new_desc))
+            return hb_retcode(MEMCH_INCR_ERR);
+
+        if (slot->value.compare_exchange_weak(old_desc, new_desc, std::memory_order_acq_rel))
+            break;
+    }
+
+    publish();
+    return hb_retcode(MEMCH_INCR_OK);
+}
+
+// Sleeps on the futex word between checks. A set anywhere wakes every
+// waiter, who then looks again. The timeout only re-checks the deadline.
+hb_retcode hartebeest::ShmHandle::wait_get(const char* key, std::string& result) {
+
+    hartebeest::Backoff deadline;
+    int n_wakeups = 0;
+
+    while (true) {
+        uint32_t seen = header->seq.load(std::memory_order_acquire);
+
+        if (get(key, result).ret_code == MEMCH_GET_OK)
+            break;
+
+        if (deadline.expired()) {
+            HB_CLOGGER->warn("Shared memory wait for <{}> gave up after {} ms, {} wakeups",
+                key, deadline.get_elapsed_ms(), n_wakeups);
+            return hb_retcode(MEMCH_WAIT_TIMEOUT_ERR);
+        }
+
+        struct timespec timeout = { 0, 100 * 1000 * 1000 };
+        shm_futex(&header->seq, FUTEX_WAIT, seen, &timeout);
+
+        n_wakeups++;
+    }
+
+    HB_CLOGGER->info("Shared memory wait for <{}>: {} ms, {} wakeups",
+        key, deadline.get_elapsed_ms(), n_wakeups);
+
+    return hb_retcode(MEMCH_GET_OK);
+}
@@ -0,0 +1,352 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_exc_tcp.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <string>
+#include <algorithm>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "./includes/hb_logger.hh"
+#include "./includes/hb_exc_tcp.hh"
+
+namespace hartebeest {
+
+    const uint32_t TCP_MAX_FIELD = 64 * 1024 * 1024;
+
+    bool tcp_write_full(int fd, const void* buf, size_t len) {
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(buf);
+
+        while (len > 0) {
+            ssize_t n = ::send(fd, ptr, len, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+
+            ptr += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    bool tcp_read_full(int fd, void* buf, size_t len) {
+        uint8_t* ptr = reinterpret_cast<uint8_t*>(buf);
+
+        while (len > 0) {
+            ssize_t n = ::recv(fd, ptr, len, 0);
+            if (n <= 0)
+                return false;
+
+            ptr += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    // A frame is a 1-byte tag, a 4-byte length, then the bytes.
+    bool tcp_write_frame(int fd, uint8_t tag, const std::string& first, const std::string* second) {
+        uint32_t lens[2] = {
+            static_cast<uint32_t>(first.size()),
+            static_cast<uint32_t>(second != nullptr ? second->size() : 0) };
+
+        return tcp_write_full(fd, &tag, 1) &&
+            tcp_write_full(fd, lens, (second != nullptr) ? sizeof(lens) : sizeof(uint32_t)) &&
+            tcp_write_full(fd, first.data(), first.size()) &&
+            ((second == nullptr) || tcp_write_full(fd, second->data(), second->size()));
+    }
+
+    bool tcp_read_field(int fd, uint32_t len, std::string& field) {
+        if (len > TCP_MAX_FIELD)
+            return false;
+
+        field.resize(len);
+        return (len == 0) || tcp_read_full(fd, &field[0], len);
+    }
+}
+
+hartebeest::TcpHandle::TcpHandle(const std::string& ip, const std::string& port, bool host) :
+    host_ip(ip), host_port(port), is_host(host), stopping(false) {
+
+    if (is_host) {
+        bool listening = listen_host();
+        assert(listening);
+    }
+
+    HB_CLOGGER->info("TCP exchanger: {} {}:{}", is_host ? "hosting at" : "host is", host_ip, host_port);
+}
+
+hartebeest::TcpHandle::~TcpHandle() {
+
+    stopping = true;
+
+    if (listen_fd >= 0) {
+        ::shutdown(listen_fd, SHUT_RDWR);
+        ::close(listen_fd);
+    }
+
+    if (accept_thread.joinable())
+        accept_thread.join();
+
+    {
+        std::lock_guard<std::mutex> guard(conn_mtx);
+        for (auto fd: conn_fds)
+            ::shutdown(fd, SHUT_RDWR);
+    }
+
+    for (auto& conn: conn_threads)
+        conn.join();
+
+    if (server_fd >= 0)
+        ::close(server_fd);
+}
+
+bool hartebeest::TcpHandle::listen_host() {
+
+    listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        return false;
+
+    int one = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(std::stoi(host_port)));
+
+    if (::bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd, 64) != 0) {
+        HB_CLOGGER->warn("TCP exchanger: cannot listen on port {}: {}", host_port, std::strerror(errno));
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    accept_thread = std::thread(&hartebeest::TcpHandle::accept_loop, this);
+    return true;
+}
+
+void hartebeest::TcpHandle::accept_loop() {
+
+    while (!stopping) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (stopping)
+                break;
+            continue;
+        }
+
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::lock_guard<std::mutex> guard(conn_mtx);
+        conn_fds.push_back(fd);
+        conn_threads.push_back(std::thread(&hartebeest::TcpHandle::serve_conn, this, fd));
+    }
+}
+
+// One thread per peer connection, until the peer leaves or we stop.
+void hartebeest::TcpHandle::serve_conn(int fd) {
+
+    uint8_t op;
+    uint32_t lens[2];
+    std::string key, val, reply;
+
+    while (!stopping) {
+        if (!tcp_read_full(fd, &op, 1) || !tcp_read_full(fd, lens, sizeof(lens)) ||
+            !tcp_read_field(fd, lens[0], key) || !tcp_read_field(fd, lens[1], val))
+            break;
+
+        uint8_t status = apply(op, key, val, reply);
+
+        if (!tcp_write_frame(fd, status, reply, nullptr))
+            break;
+    }
+
+    std::lock_guard<std::mutex> guard(conn_mtx);
+    conn_fds.erase(std::find(conn_fds.begin(), conn_fds.end(), fd));
+    ::close(fd);
+}
+
+uint8_t hartebeest::TcpHandle::apply(uint8_t op, const std::string& key, const std::string& val, std::string& reply) {
+
+    std::lock_guard<std::mutex> guard(store_mtx);
+    reply.clear();
+
+    switch (op) {
+    case TCP_OP_SET:
+        store[key] = val;
+        return TCP_STATUS_OK;
+
+    case TCP_OP_GET: {
+        auto it = store.find(key);
+        if (it == store.end())
+            return TCP_STATUS_NOT_FOUND;
+
+        reply = it->second;
+        return TCP_STATUS_OK;
+    }
+
+    case TCP_OP_DEL:
+        return (store.erase(key) > 0) ? TCP_STATUS_OK : TCP_STATUS_NOT_FOUND;
+
+    case TCP_OP_INCR: {
+        uint64_t delta;
+        if (val.size() != sizeof(delta))
+            return TCP_STATUS_ERR;
+        std::memcpy(&delta, val.data(), sizeof(delta));
+
+        uint64_t counter = 0;
+
+        // Like memcached, a value that is not a counter is an error.
+        auto it = store.find(key);
+        if (it != store.end()) {
+            const char* digits = it->second.c_str();
+            char* end = nullptr;
+
+            errno = 0;
+            counter = std::strtoull(digits, &end, 10);
+
+            if (!std::isdigit(static_cast<unsigned char>(digits[0])) || *end != '\0' || errno == ERANGE) {
+                HB_CLOGGER->warn("TCP exchanger INCR <{}>: not a counter", key);
+                return TCP_STATUS_ERR;
+            }
+        }
+
+        counter += delta;
+        store[key] = std::to_string(counter);
+
+        reply.assign(reinterpret_cast<const char*>(&counter), sizeof(counter));
+        return TCP_STATUS_OK;
+    }
+
+    default:
+        return TCP_STATUS_ERR;
+    }
+}
+
+// The host may come up after us, so retry under Backoff.
+bool hartebeest::TcpHandle::connect_host() {
+
+    struct addrinfo hints;
+    struct addrinfo* addrs = nullptr;
+
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (::getaddrinfo(host_ip.c_str(), host_port.c_str(), &hints, &addrs) != 0 || addrs == nullptr) {
+        HB_CLOGGER->warn("TCP exchanger: cannot resolve {}:{}", host_ip, host_port);
+        return false;
+    }
+
+    hartebeest::Backoff backoff;
+
+    while (true) {
+        int fd = ::socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
+
+        if (fd >= 0 && ::connect(fd, addrs->ai_addr, addrs->ai_addrlen) == 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            server_fd = fd;
+            break;
+        }
+
+        if (fd >= 0)
+            ::close(fd);
+
+        if (backoff.expired()) {
+            HB_CLOGGER->warn("TCP exchanger: host {}:{} unreachable after {} ms",
+                host_ip, host_port, backoff.get_elapsed_ms());
+            break;
+        }
+
+        backoff.wait();
+    }
+
+    ::freeaddrinfo(addrs);
+    return (server_fd >= 0);
+}
+
+uint8_t hartebeest::TcpHandle::request(uint8_t op, const std::string& key, const std::string& val, std::string& reply) {
+
+    if (is_host)
+        return apply(op, key, val, reply);
+
+    std::lock_guard<std::mutex> guard(server_mtx);
+
+    if (server_fd < 0 && !connect_host())
+        return TCP_STATUS_ERR;
+
+    uint8_t status;
+    uint32_t reply_len;
+
+    if (!tcp_write_frame(server_fd, op, key, &val) ||
+        !tcp_read_full(server_fd, &status, 1) || !tcp_read_full(server_fd, &reply_len, sizeof(reply_len)) ||
+        !tcp_read_field(server_fd, reply_len, reply)) {
+
+        // Reconnect at the next request.
+        ::close(server_fd);
+        server_fd = -1;
+
+        return TCP_STATUS_ERR;
+    }
+
+    return status;
+}
+
+// Nothing expires here, the store goes away with the host.
+hb_retcode hartebeest::TcpHandle::set(const char* key, const std::string& val, time_t expire) {
+    std::string reply;
+
+    if (request(TCP_OP_SET, key, val, reply) != TCP_STATUS_OK) {
+        HB_CLOGGER->warn("TCP exchanger SET <{}, {} bytes> failed", key, val.size());
+        return hb_retcode(MEMCH_SET_ERR);
+    }
+
+    return hb_retcode(MEMCH_SET_OK);
+}
+
+hb_retcode hartebeest::TcpHandle::get(const char* key, std::string& result) {
+    if (request(TCP_OP_GET, key, std::string(), result) != TCP_STATUS_OK)
+        return hb_retcode(MEMCH_GET_ERR);
+
+    return hb_retcode(MEMCH_GET_OK);
+}
+
+hb_retcode hartebeest::TcpHandle::del(const char* key) {
+    std::string reply;
+
+    if (request(TCP_OP_DEL, key, std::string(), reply) != TCP_STATUS_OK) {
+        HB_CLOGGER->warn("TCP exchanger DELETE <{}, ?> failed", key);
+        return hb_retcode(MEMCH_DEL_ERR);
+    }
+
+    return hb_retcode(MEMCH_DEL_OK);
+}
+
+hb_retcode hartebeest::TcpHandle::incr(const char* key, uint64_t delta, time_t expire, uint64_t& value) {
+    std::string reply;
+    std::string delta_val(reinterpret_cast<const char*>(&delta), sizeof(delta));
+
+    if (request(TCP_OP_INCR, key, delta_val, reply) != TCP_STATUS_OK || reply.size() != sizeof(value)) {
+        HB_CLOGGER->warn("TCP exchanger INCR <{}> failed", key);
+        return hb_retcode(MEMCH_INCR_ERR);
+    }
+
+    std::memcpy(&value, reply.data(), sizeof(value));
+    return hb_retcode(MEMCH_INCR_OK);
+}
@@ -8,17 +8,24 @@
 #include <cstdio>
 
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <infiniband/verbs.h>
 
 #include "./includes/hb_retcode.hh"
 #include "./includes/hb_logger.hh"
+#include "./includes/hb_cfgldr.hh"
 #include "./includes/hb_hca.hh"
 
 hartebeest::Hca::Hca() {
     std::memset(&hca_attr, 0, sizeof(struct ibv_device_attr));
+    std::memset(&hca_gid, 0, sizeof(union ibv_gid));
 }
 
-hartebeest::Hca::Hca(struct ibv_device* dev_hdl) {
+hartebeest::Hca::Hca(struct ibv_device* dev_hdl) : Hca() {
     device_register(dev_hdl);
 }
 
@@ -33,6 +40,16 @@ hb_retcode hartebeest::Hca::device_register(struct ibv_device* dev_hdl) {
 }
 
 hb_retcode hartebeest::Hca::device_reset() {
+    if (hca_xrcd != nullptr) {
+        ibv_close_xrcd(hca_xrcd);
+        hca_xrcd = nullptr;
+    }
+
+    if (hca_xrcd_fd >= 0) {
+        close(hca_xrcd_fd);
+        hca_xrcd_fd = -1;
+    }
+
     if (hca_ctx != nullptr) {
         ibv_close_device(hca_ctx);
         return hb_retcode(HCA_RETCODE_RESET_ERR);
@@ -43,6 +60,10 @@ hb_retcode hartebeest::Hca::device_reset() {
 }
 
 hb_retcode hartebeest::Hca::device_open() {
+    // Already opened, e.g. a rail sharing the default device.
+    if (hca_ctx != nullptr)
+        return hb_retcode(HCA_RETCODE_OPEN_OK);
+
     hca_ctx = ibv_open_device(hca_dev);
 
     if (ibv_query_device(hca_ctx, &hca_attr) == 0)
@@ -51,14 +72,94 @@ hb_retcode hartebeest::Hca::device_open() {
         return hb_retcode(HCA_RETCODE_OPEN_ERR);
 }
 
+// With a path, every process opening the same file on this node gets the
+// same XRC domain, so their SRQs can be reached through one recv QP.
+hb_retcode hartebeest::Hca::xrcd_open(const char* path) {
+    if (hca_xrcd != nullptr)
+        return hb_retcode(HCA_RETCODE_XRCD_OK);
+
+    struct ibv_xrcd_init_attr xrcd_attr;
+    std::memset(&xrcd_attr, 0, sizeof(xrcd_attr));
+
+    xrcd_attr.comp_mask = IBV_XRCD_INIT_ATTR_FD | IBV_XRCD_INIT_ATTR_OFLAGS;
+    xrcd_attr.fd = -1;
+    xrcd_attr.oflags = O_CREAT;
+
+    if (path != nullptr) {
+        hca_xrcd_fd = open(path, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+        if (hca_xrcd_fd < 0)
+            return hb_retcode(HCA_RETCODE_XRCD_ERR);
+        
+        xrcd_attr.fd = hca_xrcd_fd;
+    }
+
+    hca_xrcd = ibv_open_xrcd(hca_ctx, &xrcd_attr);
+    if (hca_xrcd == nullptr)
+        return hb_retcode(HCA_RETCODE_XRCD_ERR);
+
+    return hb_retcode(HCA_RETCODE_XRCD_OK);
+}
+
 struct ibv_context* hartebeest::Hca::get_device_ctx() {
     return hca_ctx;
 }
 
+struct ibv_xrcd* hartebeest::Hca::get_xrcd() {
+    return hca_xrcd;
+}
+
 struct ibv_device_attr& hartebeest::Hca::get_device_attr() {
     return hca_attr;
 }
 
+namespace hartebeest {
+    int tune_attr(const char* key, int dflt) {
+        int* val = HB_CFG_LOADER.get_attr(key);
+        return (val != nullptr && *val != ATTR_AUTO) ? *val : dflt;
+    }
+}
+
+// Fills the fields set in auto_mask. Queues are capped so that qps_per_cq
+// QPs fit in one CQ of max_cqe. Latency keeps WQEs small and inlines more,
+// throughput goes for deep queues and scatter lists.
+void hartebeest::Hca::tune_qp_cap(struct ibv_qp_cap& cap, uint32_t auto_mask) {
+
+    if (auto_mask == 0)
+        return;
+
+    bool throughput = (tune_attr("tune.goal", TUNE_GOAL_LATENCY) == TUNE_GOAL_THROUGHPUT);
+    int qps_per_cq = std::max(1, tune_attr("qps_per_cq", 1));
+
+    int max_wr = std::min(hca_attr.max_qp_wr, hca_attr.max_cqe / (2 * qps_per_cq));
+    uint32_t wr = std::max(1, std::min(throughput ? 4096 : 256, max_wr));
+    uint32_t sge = std::max(1, std::min(throughput ? 16 : 2, hca_attr.max_sge));
+
+    if (auto_mask & QP_AUTO_SEND_WR)    cap.max_send_wr = wr;
+    if (auto_mask & QP_AUTO_RECV_WR)    cap.max_recv_wr = wr;
+    if (auto_mask & QP_AUTO_SEND_SGE)   cap.max_send_sge = sge;
+    if (auto_mask & QP_AUTO_RECV_SGE)   cap.max_recv_sge = sge;
+
+    // The device does not report it. Qp halves it until creation succeeds.
+    if (auto_mask & QP_AUTO_INLINE)     cap.max_inline_data = throughput ? 64 : 256;
+}
+
+// Room for a full send and recv queue of every QP expected on the CQ.
+int hartebeest::Hca::tune_cq_depth() {
+
+    const QpProfile* profile = HB_CFG_LOADER.get_qp_profile(IBV_QPT_RC);
+
+    struct ibv_qp_cap cap = profile->cap;
+    tune_qp_cap(cap, profile->auto_mask);
+
+    int qps_per_cq = std::max(1, tune_attr("qps_per_cq", 1));
+    long depth = static_cast<long>(qps_per_cq) * (cap.max_send_wr + cap.max_recv_wr);
+
+    int cq_depth = static_cast<int>(std::max(1L, std::min(depth, static_cast<long>(hca_attr.max_cqe))));
+
+    HB_CLOGGER->info("Auto-tuned CQ depth: {} for {} QPs (max_cqe {})", cq_depth, qps_per_cq, hca_attr.max_cqe);
+    return cq_depth;
+}
+
 void hartebeest::Hca::set_device_pid(uint8_t pid) {
     hca_pid = pid;
 };
@@ -66,6 +167,39 @@ void hartebeest::Hca::set_device_plid(uint16_t plid) {
     hca_plid = plid;
 }
 
+void hartebeest::Hca::set_link_layer(uint8_t link_layer) {
+    hca_link_layer = link_layer;
+}
+
+void hartebeest::Hca::set_active_mtu(enum ibv_mtu mtu) {
+    hca_active_mtu = mtu;
+}
+
+void hartebeest::Hca::set_gid(int gid_idx, const union ibv_gid& gid) {
+    hca_gid_idx = gid_idx;
+    hca_gid = gid;
+}
+
+const uint8_t hartebeest::Hca::get_link_layer() const {
+    return hca_link_layer;
+}
+
+const enum ibv_mtu hartebeest::Hca::get_active_mtu() const {
+    return hca_active_mtu;
+}
+
+const int hartebeest::Hca::get_gid_idx() const {
+    return hca_gid_idx;
+}
+
+const union ibv_gid& hartebeest::Hca::get_gid() const {
+    return hca_gid;
+}
+
+bool hartebeest::Hca::is_roce() const {
+    return (hca_link_layer == IBV_LINK_LAYER_ETHERNET);
+}
+
 const uint8_t hartebeest::Hca::get_device_pid() const {
     return hca_pid;
 }
@@ -94,18 +228,17 @@ hb_retcode hartebeest::HcaInitializer::open_device(int idx) {
     return hca_vec.at(idx).device_open();
 }
 
-hb_retcode hartebeest::HcaInitializer::bind_port(int idx, uint8_t port_num) {
-
-    hartebeest::Hca& hca_dev = hca_vec.at(idx);
+// Fills the port's addressing without binding it to the device.
+hb_retcode hartebeest::HcaInitializer::query_port(int idx, uint8_t port_num, hartebeest::HcaPort& hca_port) {
 
     if (idx >= n_hca_devs || idx < 0)
         return hb_retcode(HCAINITR_RETCODE_RANGE_ERR);
 
+    hartebeest::Hca& hca_dev = hca_vec.at(idx);
+
     if (hca_dev.get_device_ctx() == nullptr)
         return hb_retcode(HCAINITR_RETCODE_RANGE_ERR);
 
-    uint8_t n_hca_ports = hca_dev.get_device_attr().phys_port_cnt;
-
     struct ibv_port_attr port_attr;
     std::memset(&port_attr, 0, sizeof(ibv_port_attr));
     if (ibv_query_port(hca_dev.get_device_ctx(), port_num, &port_attr))
@@ -116,15 +249,125 @@ hb_retcode hartebeest::HcaInitializer::bind_port(int idx, uint8_t port_num) {
         hb_retcode(HCAINITR_RETCODE_PORT_QUERY_ERR);
     }
 
-    if (port_attr.link_layer != IBV_LINK_LAYER_INFINIBAND) 
+    if (port_attr.link_layer != IBV_LINK_LAYER_INFINIBAND &&
+        port_attr.link_layer != IBV_LINK_LAYER_ETHERNET) 
         return hb_retcode(HCAINITR_RETCODE_NO_IB);
 
-    hca_dev.set_device_pid(port_num);
-    hca_dev.set_device_plid(port_attr.lid);
+    hca_port.hca_idx = idx;
+    hca_port.port_num = port_num;
+    hca_port.lid = port_attr.lid;
+    hca_port.link_layer = port_attr.link_layer;
+    hca_port.active_mtu = port_attr.active_mtu;
+    hca_port.gid_idx = -1;
+    std::memset(&hca_port.gid, 0, sizeof(union ibv_gid));
+
+    // Ethernet has no LID, RoCE addresses by GID.
+    if (port_attr.link_layer == IBV_LINK_LAYER_ETHERNET) {
+        int* pref_gid_idx = HB_CFG_LOADER.get_attr("gid_idx");
+        int gid_idx = find_gid_idx(idx, port_num, 
+            (pref_gid_idx != nullptr) ? *pref_gid_idx : -1);
+
+        if (gid_idx < 0)
+            return hb_retcode(HCAINITR_RETCODE_NO_GID_ERR);
+
+        if (ibv_query_gid(hca_dev.get_device_ctx(), port_num, gid_idx, &hca_port.gid))
+            return hb_retcode(HCAINITR_RETCODE_NO_GID_ERR);
+
+        hca_port.gid_idx = gid_idx;
+        HB_CLOGGER->info("RoCE port {}, GID index {}", static_cast<int>(port_num), gid_idx);
+    }
 
     return hb_retcode(HCAINITR_RETCODE_BIND_PORT_OK);
 }
 
+hb_retcode hartebeest::HcaInitializer::bind_port(int idx, uint8_t port_num) {
+
+    hartebeest::HcaPort hca_port;
+
+    hb_retcode ret = query_port(idx, port_num, hca_port);
+    if (ret.ret_code != HCAINITR_RETCODE_BIND_PORT_OK)
+        return ret;
+
+    hartebeest::Hca& hca_dev = hca_vec.at(idx);
+
+    hca_dev.set_device_pid(hca_port.port_num);
+    hca_dev.set_device_plid(hca_port.lid);
+    hca_dev.set_link_layer(hca_port.link_layer);
+    hca_dev.set_active_mtu(hca_port.active_mtu);
+
+    if (hca_port.gid_idx >= 0)
+        hca_dev.set_gid(hca_port.gid_idx, hca_port.gid);
+
+    return ret;
+}
+
+// Picks RoCE v2 with an IPv4-mapped address first, then any RoCE v2, then
+// any valid entry. A non-negative preference is taken as it is.
+int hartebeest::HcaInitializer::find_gid_idx(int idx, uint8_t port_num, int pref_gid_idx) {
+
+    if (pref_gid_idx >= 0)
+        return pref_gid_idx;
+
+    hartebeest::Hca& hca_dev = hca_vec.at(idx);
+
+    struct ibv_port_attr port_attr;
+    std::memset(&port_attr, 0, sizeof(ibv_port_attr));
+    if (ibv_query_port(hca_dev.get_device_ctx(), port_num, &port_attr))
+        return -1;
+
+    int v2_ipv4 = -1, v2_any = -1, valid_any = -1;
+    static const uint8_t ipv4_mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+    for (int gid_idx = 0; gid_idx < port_attr.gid_tbl_len; gid_idx++) {
+        struct ibv_gid_entry entry;
+        if (ibv_query_gid_ex(hca_dev.get_device_ctx(), port_num, gid_idx, &entry, 0))
+            continue;
+
+        if (entry.gid.global.interface_id == 0 && entry.gid.global.subnet_prefix == 0)
+            continue;
+
+        if (valid_any < 0)
+            valid_any = gid_idx;
+
+        if (entry.gid_type != IBV_GID_TYPE_ROCE_V2)
+            continue;
+
+        if (v2_any < 0)
+            v2_any = gid_idx;
+
+        if (v2_ipv4 < 0 && std::memcmp(entry.gid.raw, ipv4_mapped, sizeof(ipv4_mapped)) == 0)
+            v2_ipv4 = gid_idx;
+    }
+
+    if (v2_ipv4 >= 0)
+        return v2_ipv4;
+
+    return (v2_any >= 0) ? v2_any : valid_any;
+}
+
+hb_retcode hartebeest::HcaInitializer::open_devices(
+        const std::vector<std::pair<int, uint8_t>>& devs, std::vector<hartebeest::HcaPort>& hca_ports
+    ) {
+
+    hb_retcode ret;
+    for (auto& dev: devs) {
+        ret = open_device(dev.first);
+        if (ret.ret_code != HCA_RETCODE_OPEN_OK)
+            return ret;
+
+        hartebeest::HcaPort hca_port;
+        ret = query_port(dev.first, dev.second, hca_port);
+        if (ret.ret_code != HCAINITR_RETCODE_BIND_PORT_OK)
+            return ret;
+
+        hca_ports.push_back(hca_port);
+
+        HB_CLOGGER->info("HCA {} port {} opened", dev.first, static_cast<int>(dev.second));
+    }
+
+    return ret;
+}
+
 const int hartebeest::HcaInitializer::get_n_hca_devs() const {
     return n_hca_devs;
 }
@@ -4,9 +4,16 @@
  */
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <regex>
 #include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <sstream>
+#include <algorithm>
 
 #include <iostream>
 
@@ -15,6 +22,8 @@
 #include "./includes/hb_logger.hh"
 #include "./includes/hb_cfgldr.hh"
 #include "./includes/hb_memc.hh"
+#include "./includes/hb_exc_tcp.hh"
+#include "./includes/hb_exc_shm.hh"
 
 namespace hartebeest {
     const char* pdef_memc_key_prefix[] = {
@@ -30,101 +39,450 @@ namespace hartebeest {
     }
 }
 
-hartebeest::MemcHandle::MemcHandle() {
-    memc_serv_hdl = memcached_create(nullptr);
+namespace hartebeest {
+    int get_exc_attr(const char* key, int dflt) {
+        int* val = HB_CFG_LOADER.get_attr(key);
+        return (val != nullptr) ? *val : dflt;
+    }
+}
 
-    if (memc_serv_hdl == nullptr)
-        HB_CLOGGER->warn("Memcached handle acquisition failed.");
+hartebeest::Backoff::Backoff() {
+    start = std::chrono::steady_clock::now();
 
-    assert(memc_serv_hdl != nullptr);
+    delay_us = get_exc_attr("wait.initial_us", 1000);
+    max_us = get_exc_attr("wait.max_us", 200000);
+    jitter_pct = get_exc_attr("wait.jitter_pct", 25);
+    deadline_ms = get_exc_attr("wait.deadline_ms", 300000);
+
+    if (delay_us < 1)
+        delay_us = 1;
 }
 
-hartebeest::MemcHandle::~MemcHandle() {
-    if (memc_serv_hdl != nullptr)
-        memcached_free(memc_serv_hdl);
+void hartebeest::Backoff::wait() {
+    static thread_local std::mt19937 rand_gen(std::random_device{}());
+
+    int64_t sleep_us = delay_us;
+    if (jitter_pct > 0) {
+        int64_t spread = delay_us * jitter_pct / 100;
+        sleep_us += std::uniform_int_distribution<int64_t>(-spread, spread)(rand_gen);
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+
+    delay_us = (delay_us * 2 > max_us) ? max_us : delay_us * 2;
+    n_polls++;
 }
 
-hartebeest::Exchanger::Exchanger() : MemcHandle() {
+bool hartebeest::Backoff::expired() const {
+    return (deadline_ms > 0) && (get_elapsed_ms() >= deadline_ms);
+}
 
-    char* sysvar = HB_CFG_LOADER.get_sysvar("HARTEBEEST_NID");
-    assert(sysvar != nullptr);
-    nid = std::string(sysvar);
+int hartebeest::Backoff::get_n_polls() const {
+    return n_polls;
+}
 
-    sysvar = HB_CFG_LOADER.get_sysvar("HARTEBEEST_PARTICIPANTS");
-    assert(sysvar != nullptr);
-    participants = std::string(sysvar);
+int64_t hartebeest::Backoff::get_elapsed_ms() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
 
-    HB_CLOGGER->info("Exchanger: nid({}), participants({})", nid, participants);
+// Generic multi-get: one get() per key. Only the keys present are put in results.
+hb_retcode hartebeest::MemcHandle::mget(
+        const std::vector<std::string>& keys, std::map<std::string, std::string>& results
+    ) {
+    std::string val;
 
-    sysvar = HB_CFG_LOADER.get_sysvar("HARTEBEEST_EXC_IP_PORT");
-    assert(sysvar != nullptr);
+    for (auto& key: keys) {
+        if (get(key.c_str(), val).ret_code == MEMCH_GET_OK)
+            results[key] = val;
+    }
 
-    std::string memc_ip_port(sysvar);
-    std::regex regex(":");
+    return hb_retcode(MEMCH_MGET_OK);
+}
 
-    std::vector<std::string> splits(
-        std::sregex_token_iterator(memc_ip_port.begin(), memc_ip_port.end(), regex, -1),
-        std::sregex_token_iterator());
+// Generic multi-set: one set() per record.
+hb_retcode hartebeest::MemcHandle::mset(const std::map<std::string, std::string>& records, time_t expire) {
 
-    assert(splits.size() == 2);
+    for (auto& record: records) {
+        if (set(record.first.c_str(), record.second, expire).ret_code != MEMCH_SET_OK)
+            return hb_retcode(MEMCH_MSET_ERR);
+    }
+
+    return hb_retcode(MEMCH_MSET_OK);
+}
+
+// Polls get() under Backoff until the key shows up or the deadline passes.
+hb_retcode hartebeest::MemcHandle::wait_get(const char* key, std::string& result) {
+    hartebeest::Backoff backoff;
+
+    while (get(key, result).ret_code != MEMCH_GET_OK) {
+        if (backoff.expired()) {
+            HB_CLOGGER->warn("Memcached wait for <{}> gave up after {} ms, {} polls", 
+                key, backoff.get_elapsed_ms(), backoff.get_n_polls());
+            return hb_retcode(MEMCH_WAIT_TIMEOUT_ERR);
+        }
+
+        backoff.wait();
+    }
+
+    HB_CLOGGER->info("Memcached wait for <{}>: {} ms, {} polls", 
+        key, backoff.get_elapsed_ms(), backoff.get_n_polls());
+
+    return hb_retcode(MEMCH_GET_OK);
+}
+
+hartebeest::LibmemcHandle::LibmemcHandle(const std::string& ip, const std::string& port) : 
+    memc_ip(ip), memc_port(port) {
+
+    memc_serv_hdl = memcached_create(nullptr);
+
+    if (memc_serv_hdl == nullptr)
+        HB_CLOGGER->warn("Memcached handle acquisition failed.");
 
-    memc_ip = splits.at(0);
-    memc_port = splits.at(1);
+    assert(memc_serv_hdl != nullptr);
 
     memcached_return_t memc_ret;
     memc_ret = memcached_server_add(memc_serv_hdl, memc_ip.c_str(), std::stoi(memc_port.c_str()));
 
     assert(memc_ret == MEMCACHED_SUCCESS);
     HB_CLOGGER->info("Memcached server {} at port {} added: OK", memc_ip, memc_port);
+
+    // Set before the pool clones the handle.
+    noreply = (get_exc_attr("memc.noreply", 0) != 0);
+
+    memcached_behavior_set(memc_serv_hdl, MEMCACHED_BEHAVIOR_BINARY_PROTOCOL, get_exc_attr("memc.binary", 1));
+    memcached_behavior_set(memc_serv_hdl, MEMCACHED_BEHAVIOR_TCP_NODELAY, get_exc_attr("memc.tcp_nodelay", 1));
+    memcached_behavior_set(memc_serv_hdl, MEMCACHED_BEHAVIOR_NO_BLOCK, get_exc_attr("memc.no_block", 1));
+    memcached_behavior_set(memc_serv_hdl, MEMCACHED_BEHAVIOR_NOREPLY, noreply);
+
+    int pool_size = get_exc_attr("memc.pool_size", 8);
+    memc_pool = memcached_pool_create(memc_serv_hdl, 1, (pool_size > 0) ? pool_size : 1);
+
+    assert(memc_pool != nullptr);
+    HB_CLOGGER->info("Memcached pool of {} handles", pool_size);
 }
 
-hartebeest::Exchanger::~Exchanger() {
+hartebeest::LibmemcHandle::~LibmemcHandle() {
+    if (memc_pool != nullptr)
+        memcached_pool_destroy(memc_pool);
+
+    if (memc_serv_hdl != nullptr)
+        memcached_free(memc_serv_hdl);
+}
+
+// Blocks while every handle of the pool is taken.
+memcached_st* hartebeest::LibmemcHandle::acquire() {
+    memcached_return_t memc_ret;
+    memcached_st* memc_hdl = nullptr;
+
+    while (memc_hdl == nullptr) {
+        struct timespec wait_time = { 1, 0 };
+        memc_hdl = memcached_pool_fetch(memc_pool, &wait_time, &memc_ret);
+    }
 
+    return memc_hdl;
 }
 
-hb_retcode hartebeest::Exchanger::set(const char* key, const char* val) {
-    assert(memc_serv_hdl != nullptr);
+void hartebeest::LibmemcHandle::release(memcached_st* memc_hdl) {
+    memcached_pool_release(memc_pool, memc_hdl);
+}
+
+hb_retcode hartebeest::LibmemcHandle::set(const char* key, const std::string& val, time_t expire) {
+    memcached_st* memc_hdl = acquire();
 
     int keylen = std::strlen(key);
-    int vallen = std::strlen(val);
 
     memcached_return_t memc_ret;
     memc_ret = memcached_set(
-        memc_serv_hdl, key, keylen, val, vallen, static_cast<time_t>(0), static_cast<uint32_t>(0)
+        memc_hdl, key, keylen, val.data(), val.size(), expire, static_cast<uint32_t>(0)
     );
 
-    if (memc_ret != MEMCACHED_SUCCESS) {
-        HB_CLOGGER->warn("Memcached SET <{}, {}> failed", key, val);
+    release(memc_hdl);
+
+    // A no-reply set is only buffered or sent.
+    if (memc_ret != MEMCACHED_SUCCESS && memc_ret != MEMCACHED_BUFFERED) {
+        HB_CLOGGER->warn("Memcached SET <{}, {} bytes> failed", key, val.size());
         return hb_retcode(MEMCH_SET_ERR);
     }
 
     return hb_retcode(MEMCH_SET_OK);
 }
 
-hb_retcode hartebeest::Exchanger::get(const char* key, std::string& result) {
-    assert(memc_serv_hdl != nullptr);
+hb_retcode hartebeest::LibmemcHandle::get(const char* key, std::string& result) {
+    memcached_st* memc_hdl = acquire();
 
     memcached_return_t memc_ret;
     size_t vallen_ret;
     uint32_t flags_ret;
 
     char* val_ret = memcached_get(
-        memc_serv_hdl, 
+        memc_hdl, 
         key, std::strlen(key), &vallen_ret, &flags_ret, &memc_ret
     );
 
+    release(memc_hdl);
+
     if (memc_ret != MEMCACHED_SUCCESS) {
         return hb_retcode(MEMCH_GET_ERR);
     }
 
     if (memc_ret == MEMCACHED_SUCCESS) {
         result = std::string(val_ret, vallen_ret);
+        std::free(val_ret);
         return hb_retcode(MEMCH_GET_OK);
     }
 
     return hb_retcode();
 }
 
+hb_retcode hartebeest::LibmemcHandle::del(const char* key) {
+    memcached_st* memc_hdl = acquire();
+
+    memcached_return_t memc_ret;
+
+    memc_ret = memcached_delete(
+        memc_hdl, 
+        key, std::strlen(key), static_cast<time_t>(0)
+    );
+
+    release(memc_hdl);
+
+    if (memc_ret != MEMCACHED_SUCCESS && memc_ret != MEMCACHED_BUFFERED) {
+        HB_CLOGGER->warn("Memcached DELETE <{}, ?> failed", key);
+        return hb_retcode(MEMCH_DEL_ERR);
+    }
+
+    return hb_retcode(MEMCH_DEL_OK);
+}
+
+// Needs the reply, so no-reply is lifted for the call.
+hb_retcode hartebeest::LibmemcHandle::incr(const char* key, uint64_t delta, time_t expire, uint64_t& value) {
+    memcached_st* memc_hdl = acquire();
+
+    size_t keylen = std::strlen(key);
+
+    if (noreply)
+        memcached_behavior_set(memc_hdl, MEMCACHED_BEHAVIOR_NOREPLY, 0);
+
+    // The first to come creates it, the others get NOTSTORED.
+    memcached_add(memc_hdl, key, keylen, "0", 1, expire, static_cast<uint32_t>(0));
+
+    memcached_return_t memc_ret = memcached_increment(memc_hdl, key, keylen, delta, &value);
+
+    if (noreply)
+        memcached_behavior_set(memc_hdl, MEMCACHED_BEHAVIOR_NOREPLY, 1);
+
+    release(memc_hdl);
+
+    if (memc_ret != MEMCACHED_SUCCESS) {
+        HB_CLOGGER->warn("Memcached INCR <{}> failed", key);
+        return hb_retcode(MEMCH_INCR_ERR);
+    }
+
+    return hb_retcode(MEMCH_INCR_OK);
+}
+
+// One round trip for all keys. Only the keys present are put in results.
+hb_retcode hartebeest::LibmemcHandle::mget(
+        const std::vector<std::string>& keys, std::map<std::string, std::string>& results
+    ) {
+
+    if (keys.size() == 0)
+        return hb_retcode(MEMCH_MGET_OK);
+
+    std::vector<const char*> key_ptrs;
+    std::vector<size_t> key_lens;
+
+    for (auto& key: keys) {
+        key_ptrs.push_back(key.c_str());
+        key_lens.push_back(key.size());
+    }
+
+    memcached_st* memc_hdl = acquire();
+
+    memcached_return_t memc_ret;
+    memc_ret = memcached_mget(memc_hdl, key_ptrs.data(), key_lens.data(), keys.size());
+
+    if (memc_ret != MEMCACHED_SUCCESS) {
+        release(memc_hdl);
+
+        HB_CLOGGER->warn("Memcached MGET of {} keys failed", keys.size());
+        return hb_retcode(MEMCH_MGET_ERR);
+    }
+
+    memcached_result_st* result = memcached_result_create(memc_hdl, nullptr);
+
+    while (memcached_fetch_result(memc_hdl, result, &memc_ret) != nullptr) {
+        if (memc_ret != MEMCACHED_SUCCESS)
+            continue;
+
+        results[std::string(memcached_result_key_value(result), memcached_result_key_length(result))] =
+            std::string(memcached_result_value(result), memcached_result_length(result));
+    }
+
+    memcached_result_free(result);
+    release(memc_hdl);
+
+    return hb_retcode(MEMCH_MGET_OK);
+}
+
+// Sets are buffered on one handle and go out in one flush.
+hb_retcode hartebeest::LibmemcHandle::mset(const std::map<std::string, std::string>& records, time_t expire) {
+
+    if (records.size() == 0)
+        return hb_retcode(MEMCH_MSET_OK);
+
+    memcached_st* memc_hdl = acquire();
+    memcached_behavior_set(memc_hdl, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS, 1);
+
+    size_t n_failed = 0;
+    memcached_return_t memc_ret;
+
+    for (auto& record: records) {
+        memc_ret = memcached_set(
+            memc_hdl, record.first.c_str(), record.first.size(), 
+            record.second.data(), record.second.size(), expire, static_cast<uint32_t>(0)
+        );
+
+        if (memc_ret != MEMCACHED_SUCCESS && memc_ret != MEMCACHED_BUFFERED)
+            n_failed++;
+    }
+
+    memc_ret = memcached_flush_buffers(memc_hdl);
+
+    memcached_behavior_set(memc_hdl, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS, 0);
+    release(memc_hdl);
+
+    if (n_failed > 0 || memc_ret != MEMCACHED_SUCCESS) {
+        HB_CLOGGER->warn("Memcached MSET: {} of {} records failed", n_failed, records.size());
+        return hb_retcode(MEMCH_MSET_ERR);
+    }
+
+    return hb_retcode(MEMCH_MSET_OK);
+}
+
+hartebeest::Exchanger::Exchanger() {
+
+    char* sysvar = HB_CFG_LOADER.get_sysvar("HARTEBEEST_NID");
+    assert(sysvar != nullptr);
+    nid = std::string(sysvar);
+
+    sysvar = HB_CFG_LOADER.get_sysvar("HARTEBEEST_PARTICIPANTS");
+    assert(sysvar != nullptr);
+    participants = std::string(sysvar);
+
+    HB_CLOGGER->info("Exchanger: nid({}), participants({})", nid, participants);
+
+    sysvar = HB_CFG_LOADER.get_sysvar("HARTEBEEST_EXC_IP_PORT");
+    assert(sysvar != nullptr);
+
+    std::string memc_ip_port(sysvar);
+    std::regex regex(":");
+
+    std::vector<std::string> splits(
+        std::sregex_token_iterator(memc_ip_port.begin(), memc_ip_port.end(), regex, -1),
+        std::sregex_token_iterator());
+
+    assert(splits.size() == 2);
+
+    switch (get_exc_attr("backend.type", HB_EXC_BACKEND_MEMCACHED)) {
+    case HB_EXC_BACKEND_TCP: {
+        // The lowest node id hosts the store.
+        std::vector<int> nids = get_participants();
+        bool is_host = (!nids.empty() && nids.front() == std::stoi(nid));
+
+        backend = new hartebeest::TcpHandle(splits.at(0), splits.at(1), is_host);
+        break;
+    }
+
+    case HB_EXC_BACKEND_SHM:
+        backend = new hartebeest::ShmHandle(splits.at(1));
+        break;
+
+    case HB_EXC_BACKEND_MEMCACHED:
+    default:
+        backend = new hartebeest::LibmemcHandle(splits.at(0), splits.at(1));
+        break;
+    }
+
+    key_expire = static_cast<time_t>(get_exc_attr("key.expire_s", 0));
+
+    epoch = agree_epoch();
+    if (epoch > 0)
+        epoch_tag = "e" + std::to_string(epoch) + ":";
+
+    HB_CLOGGER->info("Exchanger: epoch({}), key expiry {} s", epoch, key_expire);
+}
+
+// A launcher hands every node the same HARTEBEEST_EPOCH. Otherwise, with
+// epoch.auto set, each node bumps a shared counter once per run and the
+// n-th run gets epoch n. That holds only when whole jobs restart together.
+uint64_t hartebeest::Exchanger::agree_epoch() {
+
+    const char* env_epoch = std::getenv("HARTEBEEST_EPOCH");
+    if (env_epoch != nullptr)
+        return std::stoull(env_epoch);
+
+    if (get_exc_attr("epoch.auto", 0) == 0)
+        return 0;
+
+    uint64_t n_nodes = get_participants().size();
+    uint64_t n_arrived = 0;
+
+    if (n_nodes == 0 || 
+        backend->incr("hartebeest-epoch", 1, static_cast<time_t>(0), n_arrived).ret_code != MEMCH_INCR_OK) {
+        HB_CLOGGER->warn("Exchanger: cannot agree on an epoch, keys are not tagged");
+        return 0;
+    }
+
+    return (n_arrived + n_nodes - 1) / n_nodes;
+}
+
+std::string hartebeest::Exchanger::tag(const char* key) const {
+    return epoch_tag + key;
+}
+
+std::vector<int> hartebeest::Exchanger::get_participants() const {
+    std::vector<int> nids;
+    std::stringstream stream(participants);
+    std::string token;
+
+    while (std::getline(stream, token, ',')) {
+        if (token.empty())
+            continue;
+        nids.push_back(std::stoi(token));
+    }
+
+    std::sort(nids.begin(), nids.end());
+    nids.erase(std::unique(nids.begin(), nids.end()), nids.end());
+
+    return nids;
+}
+
+hartebeest::Exchanger::~Exchanger() {
+    delete backend;
+}
+
+hartebeest::MemcHandle* hartebeest::Exchanger::get_backend() {
+    return backend;
+}
+
+uint64_t hartebeest::Exchanger::get_epoch() const {
+    return epoch;
+}
+
+hb_retcode hartebeest::Exchanger::set(const char* key, const char* val) {
+    return set(key, std::string(val));
+}
+
+hb_retcode hartebeest::Exchanger::set(const char* key, const std::string& val) {
+    return backend->set(tag(key).c_str(), val, key_expire);
+}
+
+hb_retcode hartebeest::Exchanger::get(const char* key, std::string& result) {
+    return backend->get(tag(key).c_str(), result);
+}
+
 hb_retcode hartebeest::Exchanger::prefix_set(const char* key, const int pref_idx, const char* val) {
     return set(make_key(pref_idx, key).c_str(), val);
 };
@@ -134,21 +492,74 @@ hb_retcode hartebeest::Exchanger::prefix_get(const char* key, const int pref_idx
 };
 
 hb_retcode hartebeest::Exchanger::del(const char* key) {
-    assert(memc_serv_hdl != nullptr);
+    return backend->del(tag(key).c_str());
+}
 
-    memcached_return_t memc_ret;
-    size_t vallen_ret;
-    uint32_t flags_ret;
+// Results come back under the caller's untagged keys.
+hb_retcode hartebeest::Exchanger::mget(
+        const std::vector<std::string>& keys, std::map<std::string, std::string>& results
+    ) {
+    if (epoch_tag.empty())
+        return backend->mget(keys, results);
 
-    memc_ret = memcached_delete(
-        memc_serv_hdl, 
-        key, std::strlen(key), static_cast<time_t>(0)
-    );
+    std::vector<std::string> tagged_keys;
+    for (auto& key: keys)
+        tagged_keys.push_back(tag(key.c_str()));
 
-    if (memc_ret != MEMCACHED_SUCCESS) {
-        HB_CLOGGER->warn("Memcached DELETE <{}, ?> failed", key);
-        return hb_retcode(MEMCH_DEL_ERR);
+    std::map<std::string, std::string> tagged_results;
+    hb_retcode ret = backend->mget(tagged_keys, tagged_results);
+
+    for (auto& result: tagged_results)
+        results[result.first.substr(epoch_tag.size())] = result.second;
+
+    return ret;
+}
+
+hb_retcode hartebeest::Exchanger::mset(const std::map<std::string, std::string>& records) {
+    if (epoch_tag.empty())
+        return backend->mset(records, key_expire);
+
+    std::map<std::string, std::string> tagged_records;
+    for (auto& record: records)
+        tagged_records[tag(record.first.c_str())] = record.second;
+
+    return backend->mset(tagged_records, key_expire);
+}
+
+hb_retcode hartebeest::Exchanger::wait_get(const char* key, std::string& result) {
+    return backend->wait_get(tag(key).c_str(), result);
+}
+
+// Generation g of a barrier counts arrivals in "<key>-g<g>", so a counter
+// is never reused. Each node adds one, then polls the same counter by
+// adding zero: one request per poll, whatever the number of nodes.
+hb_retcode hartebeest::Exchanger::barrier(const char* key, int n_nodes) {
+
+    uint64_t gen = ++barrier_gens[key];
+    std::string counter_key = tag(key) + "-g" + std::to_string(gen);
+    time_t expire = static_cast<time_t>(get_exc_attr("barrier.expire_s", 600));
+
+    uint64_t n_arrived = 0;
+    if (backend->incr(counter_key.c_str(), 1, expire, n_arrived).ret_code != MEMCH_INCR_OK)
+        return hb_retcode(MEMCH_BARRIER_ERR);
+
+    hartebeest::Backoff backoff;
+
+    while (n_arrived < static_cast<uint64_t>(n_nodes)) {
+        if (backoff.expired()) {
+            HB_CLOGGER->warn("Memcached barrier <{}> gave up at {}/{} after {} ms", 
+                counter_key, n_arrived, n_nodes, backoff.get_elapsed_ms());
+            return hb_retcode(MEMCH_WAIT_TIMEOUT_ERR);
+        }
+
+        backoff.wait();
+
+        if (backend->incr(counter_key.c_str(), 0, expire, n_arrived).ret_code != MEMCH_INCR_OK)
+            return hb_retcode(MEMCH_BARRIER_ERR);
     }
 
-    return hb_retcode(MEMCH_DEL_OK);
-}
\ No newline at end of file
+    HB_CLOGGER->info("Memcached barrier <{}>: {} ms, {} polls", 
+        counter_key, backoff.get_elapsed_ms(), backoff.get_n_polls());
+
+    return hb_retcode(MEMCH_BARRIER_OK);
+}
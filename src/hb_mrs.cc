@@ -4,6 +4,7 @@
  */
 
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <cstdlib>
@@ -13,11 +14,13 @@
 #include "./includes/hb_alloc.hh"
 #include "./includes/hb_mrs.hh"
 
-hartebeest::Mr::Mr(size_t len) {
+hartebeest::Mr::Mr(size_t len, size_t align) {
     name = std::string("ANONYMOUS-MR");
 
+    length = len;
     if (len > 0) {
-        buffer = hartebeest::alloc_buffer(len, 64);
+        // aligned_alloc wants the size in whole multiples of the alignment.
+        buffer = hartebeest::alloc_buffer(((len + align - 1) / align) * align, align);
         assert(buffer != nullptr);
 
         type = hartebeest::MR_TYPE_LOCAL;
@@ -27,15 +30,33 @@ hartebeest::Mr::Mr(size_t len) {
     }
 }
 
-hartebeest::Mr::Mr(const char* key, size_t len) : Mr(len) {
+hartebeest::Mr::Mr(const char* key, size_t len, size_t align) : Mr(len, align) {
     name = std::string(key);
 }
 
+hartebeest::Mr::Mr(const char* key, uint8_t* borrowed, size_t len) : Mr(0) {
+    name = std::string(key);
+
+    buffer = borrowed;
+    length = len;
+    own_buffer = false;
+    type = hartebeest::MR_TYPE_LOCAL;
+}
+
 hartebeest::Mr::~Mr() {
-    if (is_mr_created())
-        ibv_dereg_mr(mr);
+    if (chunk_mrs.size() > 0) {
+        for (auto chunk: chunk_mrs)
+            ibv_dereg_mr(chunk);
+    }
+    else if (is_mr_created()) {
+        // Remote containers hold a plain copy from unflatten_info().
+        if (type == MR_TYPE_LOCAL)
+            ibv_dereg_mr(mr);
+        else
+            std::free(mr);
+    }
 
-    if (is_allocated())
+    if (is_allocated() && own_buffer)
         hartebeest::free_buffer(buffer);
 }
 
@@ -55,14 +76,64 @@ uint8_t* hartebeest::Mr::get_buffer() const {
     return buffer;
 }
 
+size_t hartebeest::Mr::get_length() const {
+    return length;
+}
+
 struct ibv_mr* hartebeest::Mr::get_mr() const {
     return mr;
 }
 
+bool hartebeest::Mr::is_chunked() const {
+    return (chunk_rkeys.size() > 1);
+}
+
+size_t hartebeest::Mr::get_n_chunks() const {
+    return is_chunked() ? chunk_rkeys.size() : 1;
+}
+
+size_t hartebeest::Mr::get_chunk_len() const {
+    return is_chunked() ? chunk_len : length;
+}
+
+// Offset is relative to the start of the logical buffer.
+uint32_t hartebeest::Mr::get_lkey(size_t offset) const {
+    if (!is_chunked())
+        return mr->lkey;
+
+    assert(offset / chunk_len < chunk_lkeys.size());
+    return chunk_lkeys[offset / chunk_len];
+}
+
+uint32_t hartebeest::Mr::get_rkey(size_t offset) const {
+    if (!is_chunked())
+        return mr->rkey;
+
+    assert(offset / chunk_len < chunk_rkeys.size());
+    return chunk_rkeys[offset / chunk_len];
+}
+
 void hartebeest::Mr::set_mr(struct ibv_mr* ptr) {
     mr = ptr;
 }
 
+void hartebeest::Mr::set_chunks(std::vector<struct ibv_mr*>& chunks, size_t len) {
+    assert(chunks.size() > 0);
+
+    chunk_mrs = chunks;
+    chunk_len = len;
+
+    chunk_lkeys.clear();
+    chunk_rkeys.clear();
+    for (auto chunk: chunk_mrs) {
+        chunk_lkeys.push_back(chunk->lkey);
+        chunk_rkeys.push_back(chunk->rkey);
+    }
+
+    // First chunk stands for the whole, for get_mr() users.
+    mr = chunk_mrs.front();
+}
+
 void hartebeest::Mr::set_type(enum hartebeest::MrType mr_type) {
     type = mr_type;
 }
@@ -78,6 +149,21 @@ std::string hartebeest::Mr::flatten_info() {
         << mr->lkey << ":"
         << mr->rkey;
 
+    // Chunked: logical length replaces the first chunk's, keys per chunk follow.
+    if (is_chunked()) {
+        stream.str("");
+        stream 
+            << name << ":"
+            << std::hex << reinterpret_cast<uintptr_t>(buffer) << ":"
+            << length << ":"
+            << chunk_lkeys.front() << ":"
+            << chunk_rkeys.front() << ":"
+            << chunk_len;
+
+        for (auto rkey: chunk_rkeys)
+            stream << ":" << rkey;
+    }
+
     return stream.str();
 }
 
@@ -102,4 +188,66 @@ void hartebeest::Mr::unflatten_info(const char* fetch) {
 
     mr->addr = reinterpret_cast<void*>(buf_addr);
     buffer = reinterpret_cast<uint8_t*>(buf_addr);
-}
\ No newline at end of file
+    length = mr->length;
+
+    // The address is the peer's, never ours to free.
+    own_buffer = false;
+    type = hartebeest::MR_TYPE_REMOTE;
+
+    uint32_t rkey;
+    if (stream >> std::hex >> chunk_len) {
+        while (stream >> std::hex >> rkey)
+            chunk_rkeys.push_back(rkey);
+    }
+    // Remote side never uses lkeys, keep the vectors the same length.
+    chunk_lkeys.assign(chunk_rkeys.size(), 0);
+}
+void hartebeest::Mr::encode_wire(hartebeest::WireWriter& writer) {
+    assert(mr != nullptr);
+
+    size_t n_chunks = is_chunked() ? chunk_rkeys.size() : 0;
+    size_t rec_len = sizeof(WireMr) + n_chunks * sizeof(uint32_t);
+
+    WireMr* rec = reinterpret_cast<WireMr*>(writer.append(WIRE_KIND_MR, name.c_str(), rec_len));
+
+    rec->addr = reinterpret_cast<uintptr_t>(is_chunked() ? buffer : mr->addr);
+    rec->length = is_chunked() ? length : mr->length;
+    rec->chunk_len = is_chunked() ? chunk_len : 0;
+    rec->lkey = get_lkey();
+    rec->rkey = get_rkey();
+    rec->n_chunks = n_chunks;
+
+    uint32_t* rkeys = reinterpret_cast<uint32_t*>(rec + 1);
+    for (size_t i = 0; i < n_chunks; i++)
+        rkeys[i] = chunk_rkeys[i];
+}
+
+// get_mr() users read addr and rkey off an ibv_mr, so the record is copied
+// into a plain one instead of being kept as a view into the fetched value.
+void hartebeest::Mr::decode_wire(const hartebeest::WireMr* rec) {
+    assert(is_allocated() == false);
+    assert(rec->rec.kind == WIRE_KIND_MR);
+
+    mr = reinterpret_cast<struct ibv_mr*>(std::malloc(sizeof(struct ibv_mr)));
+    std::memset(mr, 0, sizeof(struct ibv_mr));
+
+    name = wire_name(&rec->rec);
+
+    mr->addr = reinterpret_cast<void*>(rec->addr);
+    mr->length = rec->length;
+    mr->lkey = rec->lkey;
+    mr->rkey = rec->rkey;
+
+    buffer = reinterpret_cast<uint8_t*>(rec->addr);
+    length = rec->length;
+    own_buffer = false;
+    type = hartebeest::MR_TYPE_REMOTE;
+
+    if (rec->n_chunks > 0) {
+        const uint32_t* rkeys = reinterpret_cast<const uint32_t*>(rec + 1);
+
+        chunk_len = rec->chunk_len;
+        chunk_rkeys.assign(rkeys, rkeys + rec->n_chunks);
+        chunk_lkeys.assign(chunk_rkeys.size(), 0);
+    }
+}
@@ -0,0 +1,133 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_mws.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <sstream>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./includes/hb_mws.hh"
+
+hartebeest::Mw::Mw(const char* key, struct ibv_pd* pd) {
+    name = std::string(key);
+
+    mw = ibv_alloc_mw(pd, IBV_MW_TYPE_2);
+    if (mw == nullptr)
+        HB_CLOGGER->warn("Memory window allocation failed: {}", name);
+}
+
+hartebeest::Mw::~Mw() {
+    if (is_mw_created())
+        ibv_dealloc_mw(mw);
+}
+
+bool hartebeest::Mw::is_mw_created() const {
+    return (mw != nullptr);
+}
+
+bool hartebeest::Mw::is_bound() const {
+    return bound;
+}
+
+const char* hartebeest::Mw::get_name() const {
+    return name.c_str();
+}
+
+struct ibv_mw* hartebeest::Mw::get_mw() const {
+    return mw;
+}
+
+uint32_t hartebeest::Mw::get_rkey() const {
+    return bound_rkey;
+}
+
+hb_retcode hartebeest::Mw::bind(struct ibv_qp* qp, hartebeest::Mr* mr, size_t offset, size_t len, int rights, uint64_t work_id) {
+
+    assert(mw != nullptr);
+    assert(mr != nullptr && mr->get_mr() != nullptr);
+
+    if (offset + len > mr->get_mr()->length)
+        return hb_retcode(MW_BIND_ERR);
+
+    struct ibv_send_wr work_req;
+    struct ibv_send_wr* bad_work_req = nullptr;
+    std::memset(&work_req, 0, sizeof(work_req));
+
+    // Type-2 windows take a fresh rkey at every bind, so stale grants die.
+    uint32_t next_rkey = ibv_inc_rkey(mw->rkey);
+
+    work_req.wr_id = work_id;
+    work_req.opcode = IBV_WR_BIND_MW;
+    work_req.send_flags = IBV_SEND_SIGNALED;
+    work_req.next = nullptr;
+
+    work_req.bind_mw.mw = mw;
+    work_req.bind_mw.rkey = next_rkey;
+    work_req.bind_mw.bind_info.mr = mr->get_mr();
+    work_req.bind_mw.bind_info.addr = reinterpret_cast<uintptr_t>(mr->get_buffer()) + offset;
+    work_req.bind_mw.bind_info.length = len;
+    work_req.bind_mw.bind_info.mw_access_flags = rights;
+
+    int ret = ibv_post_send(qp, &work_req, &bad_work_req);
+
+    if (ret != 0 || bad_work_req != nullptr) {
+        HB_CLOGGER->warn("MW({}) bind post unusual return: {}", name, ret);
+        return hb_retcode(MW_BIND_ERR);
+    }
+
+    mw->rkey = next_rkey;
+
+    bound_addr = work_req.bind_mw.bind_info.addr;
+    bound_len = len;
+    bound_rkey = next_rkey;
+    bound = true;
+
+    return hb_retcode(MW_BIND_OK);
+}
+
+hb_retcode hartebeest::Mw::invalidate(struct ibv_qp* qp, uint64_t work_id) {
+
+    assert(mw != nullptr);
+
+    if (!bound)
+        return hb_retcode(MW_INVALIDATE_ERR);
+
+    struct ibv_send_wr work_req;
+    struct ibv_send_wr* bad_work_req = nullptr;
+    std::memset(&work_req, 0, sizeof(work_req));
+
+    work_req.wr_id = work_id;
+    work_req.opcode = IBV_WR_LOCAL_INV;
+    work_req.send_flags = IBV_SEND_SIGNALED;
+    work_req.invalidate_rkey = bound_rkey;
+    work_req.next = nullptr;
+
+    int ret = ibv_post_send(qp, &work_req, &bad_work_req);
+
+    if (ret != 0 || bad_work_req != nullptr) {
+        HB_CLOGGER->warn("MW({}) invalidate post unusual return: {}", name, ret);
+        return hb_retcode(MW_INVALIDATE_ERR);
+    }
+
+    bound = false;
+    return hb_retcode(MW_INVALIDATE_OK);
+}
+
+// Same layout as Mr::flatten_info, so remotes fetch it as an MR.
+std::string hartebeest::Mw::flatten_info() {
+    std::ostringstream stream;
+
+    assert(bound);
+    stream
+        << name << ":"
+        << std::hex << bound_addr << ":"
+        << bound_len << ":"
+        << 0 << ":"
+        << bound_rkey;
+
+    return stream.str();
+}
@@ -5,12 +5,18 @@
 
 #include <cassert>
 
+#include <unistd.h>
+
 #include <iostream>
 #include <cstdint>
+#include <cstring>
+#include <thread>
 #include <infiniband/verbs.h>
 
 #include "./includes/hb_retcode.hh"
 #include "./includes/hb_logger.hh"
+#include "./includes/hb_alloc.hh"
+#include "./includes/hb_cfgldr.hh"
 #include "./includes/hb_pds.hh"
 
 
@@ -24,12 +30,31 @@ hartebeest::Pd::Pd(const char* name, hartebeest::Hca& hca_dev) {
 
 hartebeest::Pd::~Pd() {
     
+    // Windows first, they hold references to the MRs.
+    for (auto it: mw_cache.get_resrc_map())
+        delete it.second;
+
     // Delete Allocated MRs 
     for (auto it: mr_cache.get_resrc_map())
         delete it.second;
 
     for (auto it: qp_cache.get_resrc_map())
         delete it.second;
+
+    for (auto pooled: qp_pool)
+        delete pooled;
+
+    // SRQs go after the QPs that feed them.
+    for (auto it: srq_cache.get_resrc_map())
+        delete it.second;
+
+    ah_cache.clear();
+
+    if (parent_pd != nullptr)
+        ibv_dealloc_pd(parent_pd);
+
+    if (td != nullptr)
+        ibv_dealloc_td(td);
     
     if (pd != nullptr)
         ibv_dealloc_pd(pd);
@@ -39,10 +64,53 @@ struct ibv_pd* hartebeest::Pd::get_pd() {
     return pd;
 }
 
+// QPs are created against this one. MRs always use the plain PD.
+struct ibv_pd* hartebeest::Pd::get_qp_pd() {
+    return (parent_pd != nullptr) ? parent_pd : pd;
+}
+
+struct ibv_td* hartebeest::Pd::get_td() {
+    return td;
+}
+
 hartebeest::Hca* hartebeest::Pd::get_hca() {
     return hca_ln;
 }
 
+// The caller promises that one thread at a time posts to the QPs of this Pd.
+hb_retcode hartebeest::Pd::bind_thread_domain() {
+
+    if (is_thread_bound())
+        return hb_retcode(PD_RETCODE_ALLOC_TD_OK);
+
+    struct ibv_td_init_attr td_attr;
+    std::memset(&td_attr, 0, sizeof(td_attr));
+
+    td = ibv_alloc_td(hca_ln->get_device_ctx(), &td_attr);
+    if (td == nullptr)
+        return hb_retcode(PD_RETCODE_ALLOC_TD_ERR);
+
+    struct ibv_parent_domain_init_attr pd_attr;
+    std::memset(&pd_attr, 0, sizeof(pd_attr));
+
+    pd_attr.pd = pd;
+    pd_attr.td = td;
+
+    parent_pd = ibv_alloc_parent_domain(hca_ln->get_device_ctx(), &pd_attr);
+    if (parent_pd == nullptr) {
+        ibv_dealloc_td(td);
+        td = nullptr;
+
+        return hb_retcode(PD_RETCODE_ALLOC_TD_ERR);
+    }
+
+    return hb_retcode(PD_RETCODE_ALLOC_TD_OK);
+}
+
+bool hartebeest::Pd::is_thread_bound() const {
+    return (parent_pd != nullptr);
+}
+
 hb_retcode hartebeest::Pd::create_mr(const char* key, size_t len, int rights) {
 
     // Make it seated at Heap.
@@ -70,11 +138,122 @@ hb_retcode hartebeest::Pd::create_mr(const char* key, size_t len, int rights) {
     return ret;
 }
 
-hb_retcode hartebeest::Pd::create_qp(const char* qp_name, enum ibv_qp_type conn_type, struct ibv_cq* sq, struct ibv_cq* rq) {
+// Registers a buffer owned by someone else, e.g. the same buffer on another HCA.
+hb_retcode hartebeest::Pd::create_mr(const char* key, uint8_t* buffer, size_t len, int rights) {
+
+    if (mr_cache.is_registered(key))
+        return hb_retcode(PD_RETCODE_CREATE_MR_ERR);
+
+    struct ibv_mr* ptr = ibv_reg_mr(this->pd, reinterpret_cast<void*>(buffer), len, rights);
+    if (ptr == nullptr)
+        return hb_retcode(PD_RETCODE_IB_REG_MR_ERR);
+
+    hartebeest::Mr* new_mr = new hartebeest::Mr(key, buffer, len);
+    new_mr->set_mr(ptr);
+
+    hb_retcode ret = mr_cache.register_resrc(key, new_mr);
+
+    if (ret.ret_code != CACHE_RETCODE_REGISTER_OK) {
+        delete new_mr;      // Deregisters, the buffer stays with its owner.
+        ret.append_str(PD_RETCODE_CREATE_MR_ERR);
+        ret.ret_code = PD_RETCODE_CREATE_MR_ERR;
+    }
+    else {
+        ret.append_str(PD_RETCODE_CREATE_MR_OK);
+        ret.ret_code = PD_RETCODE_CREATE_MR_OK;
+    }
+
+    return ret;
+}
+
+hb_retcode hartebeest::Pd::create_mr_parallel(const char* key, size_t len, int rights, int n_threads, size_t chunk_len) {
+
+    if (mr_cache.is_registered(key))
+        return hb_retcode(PD_RETCODE_CREATE_MR_ERR);
+
+    if (n_threads <= 0)
+        n_threads = std::thread::hardware_concurrency();
+    if (n_threads <= 0)
+        n_threads = 1;
+
+    // Page aligned buffer, so chunk boundaries and prefault strides fall on pages.
+    size_t page_sz = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    hartebeest::Mr* new_mr = new hartebeest::Mr(key, len, page_sz);
+    uint8_t* buffer = new_mr->get_buffer();
+
+    // Faulting in pages is the part ibv_reg_mr would otherwise do alone.
+    hartebeest::prefault_buffer(buffer, len, n_threads);
+
+    // Chunks are kept page aligned.
+    if (chunk_len == 0 || chunk_len >= len)
+        chunk_len = len;
+    else
+        chunk_len = ((chunk_len + page_sz - 1) / page_sz) * page_sz;
+
+    size_t n_chunks = (len + chunk_len - 1) / chunk_len;
+    std::vector<struct ibv_mr*> chunks(n_chunks, nullptr);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < n_threads && static_cast<size_t>(t) < n_chunks; t++) {
+        workers.push_back(std::thread([this, t, n_threads, n_chunks, chunk_len, len, buffer, rights, &chunks]() {
+            for (size_t idx = t; idx < n_chunks; idx += n_threads) {
+                size_t offset = idx * chunk_len;
+                size_t this_len = (offset + chunk_len > len) ? (len - offset) : chunk_len;
+
+                chunks[idx] = ibv_reg_mr(this->pd, buffer + offset, this_len, rights);
+            }
+        }));
+    }
+
+    for (auto& worker: workers)
+        worker.join();
+
+    bool reg_failed = false;
+    for (auto chunk: chunks)
+        reg_failed |= (chunk == nullptr);
+
+    if (reg_failed) {
+        for (auto chunk: chunks)
+            if (chunk != nullptr)
+                ibv_dereg_mr(chunk);
+
+        delete new_mr;
+        return hb_retcode(PD_RETCODE_IB_REG_MR_ERR);
+    }
+
+    if (n_chunks == 1)
+        new_mr->set_mr(chunks.front());
+    else
+        new_mr->set_chunks(chunks, chunk_len);
+
+    hb_retcode ret = mr_cache.register_resrc(key, new_mr);
     
-    hartebeest::Qp* new_qp = new hartebeest::Qp(qp_name, conn_type, this, sq, rq);
+    if (ret.ret_code != CACHE_RETCODE_REGISTER_OK) {
+        ret.append_str(PD_RETCODE_CREATE_MR_ERR);
+        ret.ret_code = PD_RETCODE_CREATE_MR_ERR;
+    }
+    else {
+        ret.append_str(PD_RETCODE_CREATE_MR_OK);
+        ret.ret_code = PD_RETCODE_CREATE_MR_OK;
+    }
+
+    return ret;
+}
+
+hb_retcode hartebeest::Pd::create_qp(
+        const char* qp_name, enum ibv_qp_type conn_type, struct ibv_cq* sq, struct ibv_cq* rq, const char* profile_name
+    ) {
+    
+    hartebeest::Qp* new_qp = new hartebeest::Qp(qp_name, conn_type, this, sq, rq, profile_name);
     assert(new_qp != nullptr);
 
+    // Its CQs had no room for its queues.
+    if (!new_qp->is_qp_created()) {
+        delete new_qp;
+        return hb_retcode(PD_RETCODE_CREATE_QP_ERR);
+    }
+
     hb_retcode ret = qp_cache.register_resrc(qp_name, new_qp);
 
     if (ret.ret_code != CACHE_RETCODE_REGISTER_OK) {
@@ -89,6 +268,146 @@ hb_retcode hartebeest::Pd::create_qp(const char* qp_name, enum ibv_qp_type conn_
     return ret;
 }
 
+hb_retcode hartebeest::Pd::create_mw(const char* mw_name) {
+
+    hartebeest::Mw* new_mw = new hartebeest::Mw(mw_name, this->pd);
+    if (!new_mw->is_mw_created()) {
+        delete new_mw;
+        return hb_retcode(PD_RETCODE_CREATE_MW_ERR);
+    }
+
+    hb_retcode ret = mw_cache.register_resrc(mw_name, new_mw);
+
+    if (ret.ret_code != CACHE_RETCODE_REGISTER_OK) {
+        delete new_mw;
+        ret.append_str(PD_RETCODE_CREATE_MW_ERR);
+        ret.ret_code = PD_RETCODE_CREATE_MW_ERR;
+    }
+    else {
+        ret.append_str(PD_RETCODE_CREATE_MW_OK);
+        ret.ret_code = PD_RETCODE_CREATE_MW_OK;
+    }
+
+    return ret;
+}
+
+// Needs the HCA's XRC domain opened beforehand.
+hb_retcode hartebeest::Pd::create_xrc_srq(const char* srq_name, struct ibv_cq* cq) {
+
+    if (hca_ln->get_xrcd() == nullptr)
+        return hb_retcode(PD_RETCODE_CREATE_SRQ_ERR);
+
+    const QpProfile* profile = HB_CFG_LOADER.get_qp_profile(IBV_QPT_RC);
+
+    struct ibv_qp_cap cap = profile->cap;
+    hca_ln->tune_qp_cap(cap, profile->auto_mask);
+
+    hartebeest::XrcSrq* new_srq = new hartebeest::XrcSrq(srq_name, this->pd, hca_ln->get_xrcd(), cq, cap);
+    if (!new_srq->is_srq_created()) {
+        delete new_srq;
+        return hb_retcode(PD_RETCODE_CREATE_SRQ_ERR);
+    }
+
+    hb_retcode ret = srq_cache.register_resrc(srq_name, new_srq);
+
+    if (ret.ret_code != CACHE_RETCODE_REGISTER_OK) {
+        delete new_srq;
+        ret.append_str(PD_RETCODE_CREATE_SRQ_ERR);
+        ret.ret_code = PD_RETCODE_CREATE_SRQ_ERR;
+    }
+    else {
+        ret.append_str(PD_RETCODE_CREATE_SRQ_OK);
+        ret.ret_code = PD_RETCODE_CREATE_SRQ_OK;
+    }
+
+    return ret;
+}
+
+hb_retcode hartebeest::Pd::create_qp_pool(int n_qps, enum ibv_qp_type conn_type, struct ibv_cq* sq, struct ibv_cq* rq) {
+
+    assert(qp_pool.size() == 0);
+
+    pool_conn_type = conn_type;
+    pool_sq = sq;
+    pool_rq = rq;
+
+    for (int i = 0; i < n_qps; i++) {
+        std::string pooled_name = name + "-pooled-" + std::to_string(i);
+        
+        hartebeest::Qp* new_qp = new hartebeest::Qp(pooled_name.c_str(), conn_type, this, sq, rq);
+        if (!new_qp->is_qp_created() || new_qp->transit_init().ret_code != QP_TRANSITION_2_INIT_OK) {
+            delete new_qp;
+            return hb_retcode(PD_RETCODE_QP_POOL_ERR);
+        }
+
+        qp_pool.push_back(new_qp);
+    }
+
+    return hb_retcode(PD_RETCODE_QP_POOL_OK);
+}
+
+// Takes an INIT-state QP out of the pool under the given name.
+// When the pool ran dry, a new one is created on the spot.
+hb_retcode hartebeest::Pd::acquire_qp(const char* qp_name) {
+
+    if (qp_cache.is_registered(qp_name))
+        return hb_retcode(PD_RETCODE_QP_POOL_ERR);
+
+    hartebeest::Qp* pooled = nullptr;
+
+    if (qp_pool.size() > 0) {
+        pooled = qp_pool.back();
+        qp_pool.pop_back();
+    }
+    else {
+        assert(pool_sq != nullptr && pool_rq != nullptr);
+        
+        pooled = new hartebeest::Qp(qp_name, pool_conn_type, this, pool_sq, pool_rq);
+        if (!pooled->is_qp_created() || pooled->transit_init().ret_code != QP_TRANSITION_2_INIT_OK) {
+            delete pooled;
+            return hb_retcode(PD_RETCODE_QP_POOL_ERR);
+        }
+    }
+
+    pooled->set_name(qp_name);
+    qp_cache.register_resrc(qp_name, pooled);
+
+    return hb_retcode(PD_RETCODE_QP_POOL_OK);
+}
+
+// Recycles through RESET and INIT, so the next user only pays RTR/RTS.
+hb_retcode hartebeest::Pd::release_qp(const char* qp_name) {
+
+    hartebeest::Qp* released = qp_cache.get_resrc(qp_name);
+    if (released == nullptr)
+        return hb_retcode(PD_RETCODE_QP_POOL_ERR);
+
+    qp_cache.deregister_resrc(qp_name);
+
+    bool poolable = 
+        (released->get_conn_type() == pool_conn_type) &&
+        (released->get_qp()->send_cq == pool_sq) &&
+        (released->get_qp()->recv_cq == pool_rq);
+
+    if (!poolable ||
+        released->transit_reset().ret_code != QP_TRANSITION_2_RESET_OK ||
+        released->transit_init().ret_code != QP_TRANSITION_2_INIT_OK) {
+        
+        delete released;
+        return hb_retcode(PD_RETCODE_QP_POOL_OK);
+    }
+
+    std::string pooled_name = name + "-pooled";
+    released->set_name(pooled_name.c_str());
+    qp_pool.push_back(released);
+
+    return hb_retcode(PD_RETCODE_QP_POOL_OK);
+}
+
+size_t hartebeest::Pd::get_qp_pool_size() const {
+    return qp_pool.size();
+}
+
 hartebeest::ResourceCache<hartebeest::Mr>& hartebeest::Pd::get_mr_cache() {
     return this->mr_cache;
 }
@@ -97,6 +416,18 @@ hartebeest::ResourceCache<hartebeest::Qp>& hartebeest::Pd::get_qp_cache() {
     return this->qp_cache;
 }
 
+hartebeest::ResourceCache<hartebeest::Mw>& hartebeest::Pd::get_mw_cache() {
+    return this->mw_cache;
+}
+
+hartebeest::ResourceCache<hartebeest::XrcSrq>& hartebeest::Pd::get_srq_cache() {
+    return this->srq_cache;
+}
+
+hartebeest::AhCache& hartebeest::Pd::get_ah_cache() {
+    return this->ah_cache;
+}
+
 hartebeest::PdCache::PdCache(const char* name) : ResourceCache<Pd>(name) {
     
 }
\ No newline at end of file
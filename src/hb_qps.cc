@@ -4,8 +4,11 @@
  */
 
 #include <string>
+#include <cstring>
 #include <sstream>
+#include <iomanip>
 #include <cstdlib>
+#include <cerrno>
 
 #include <memory>
 #include <cassert>
@@ -18,33 +21,30 @@
 #include "./includes/hb_logger.hh"
 
 #include "./includes/hb_cfgldr.hh"
+#include "./includes/hb_cqs.hh"
 #include "./includes/hb_pds.hh"
 #include "./includes/hb_qps.hh"
 
 namespace hartebeest {
-    std::string prefix_key(enum ibv_qp_type connect_type, const char* key) {
-        if (connect_type == IBV_QPT_RC)
-            return (std::string("rc:").append(key));
-        
-        else if (connect_type == IBV_QPT_UC)
-            return (std::string("uc:").append(key));
-
-        else if (connect_type == IBV_QPT_UD)
-            return (std::string("ud:").append(key));
-
-        else
-            assert(false);
-
-        return nullptr;
-    }
-
-    const int get_pref_attr(enum ibv_qp_type connect_type, const char* key) {
-        return *HB_CFG_LOADER.get_attr(prefix_key(connect_type, key).c_str());
+    // 20-bit label from both ends, so each QP hashes to its own ECMP path.
+    // RoCE v2 providers derive the UDP source port from it.
+    uint32_t make_flow_label(uint32_t local_qpn, uint32_t remote_qpn) {
+        uint64_t mixed = (static_cast<uint64_t>(local_qpn) << 24) ^ remote_qpn;
+        mixed *= 0x9E3779B97F4A7C15ULL;
+
+        uint32_t label = static_cast<uint32_t>(mixed >> 44) & 0xFFFFF;
+        return (label == 0) ? 1 : label;
     }
 }
 
-hartebeest::Qp::Qp(const char* id, enum ibv_qp_type connect_type, hartebeest::Pd* inv_pd, struct ibv_cq* sq, struct ibv_cq* rq) {
+hartebeest::Qp::Qp(
+        const char* id, enum ibv_qp_type connect_type, hartebeest::Pd* inv_pd, 
+        struct ibv_cq* sq, struct ibv_cq* rq, const char* profile_name, bool quiet_logs
+    ) {
     name = std::string(id);
+    quiet = quiet_logs;
+    std::memset(&gid, 0, sizeof(union ibv_gid));
+    std::memset(&cap, 0, sizeof(struct ibv_qp_cap));
 
     // Assumed to be local
     if (inv_pd != nullptr) {
@@ -52,38 +52,70 @@ hartebeest::Qp::Qp(const char* id, enum ibv_qp_type connect_type, hartebeest::Pd
         pos_type = hartebeest::QP_TYPE_LOCAL;
         conn_type = connect_type;
 
-        assert(sq != nullptr);
-        assert(rq != nullptr);
-
         pid = inv_pd->get_hca()->get_device_pid();
         plid = inv_pd->get_hca()->get_device_plid();
 
+        gid_idx = inv_pd->get_hca()->get_gid_idx();
+        gid = inv_pd->get_hca()->get_gid();
+        active_mtu = inv_pd->get_hca()->get_active_mtu();
+
+        profile = HB_CFG_LOADER.get_qp_profile(conn_type, profile_name);
+
         struct ibv_qp_init_attr init_qp_attr;
         std::memset(&init_qp_attr, 0, sizeof(struct ibv_qp_init_attr));
 
-        init_qp_attr.qp_type = connect_type;
-        init_qp_attr.cap.max_send_wr = get_pref_attr(conn_type, "cap.max_send_wr");
-        init_qp_attr.cap.max_recv_wr = get_pref_attr(conn_type, "cap.max_recv_wr");
-        init_qp_attr.cap.max_send_sge = get_pref_attr(conn_type, "cap.max_send_sge");
-        init_qp_attr.cap.max_recv_sge = get_pref_attr(conn_type, "cap.max_recv_sge");
-        init_qp_attr.cap.max_inline_data = get_pref_attr(conn_type, "cap.max_inline_data");
-
-        init_qp_attr.send_cq = sq;
-        init_qp_attr.recv_cq = rq;
+        init_qp_attr.cap = profile->cap;
+        inv_pd->get_hca()->tune_qp_cap(init_qp_attr.cap, profile->auto_mask);
+
+        if (!attach_cqs(sq, rq, init_qp_attr.cap)) {
+            HB_CLOGGER->warn("QP({}) not created, no room on its CQs", name);
+            return;
+        }
+
+        if (is_xrc()) {
+            create_xrc(inv_pd, sq, init_qp_attr);
+        }
+        else {
+            assert(sq != nullptr);
+            assert(rq != nullptr);
+
+            init_qp_attr.qp_type = connect_type;
+            init_qp_attr.send_cq = sq;
+            init_qp_attr.recv_cq = rq;
+
+            qp = ibv_create_qp(inv_pd->get_qp_pd(), &init_qp_attr);
+
+            // An auto inline size is a guess. Halve it until the device takes it.
+            while (qp == nullptr && (profile->auto_mask & QP_AUTO_INLINE) && init_qp_attr.cap.max_inline_data > 0) {
+                init_qp_attr.cap.max_inline_data /= 2;
+                qp = ibv_create_qp(inv_pd->get_qp_pd(), &init_qp_attr);
+            }
+        }
+
+        if (profile->auto_mask != 0 && !quiet)
+            HB_CLOGGER->info("QP({}) auto-tuned: send_wr {}, recv_wr {}, send_sge {}, recv_sge {}, inline {}",
+                name, init_qp_attr.cap.max_send_wr, init_qp_attr.cap.max_recv_wr,
+                init_qp_attr.cap.max_send_sge, init_qp_attr.cap.max_recv_sge, init_qp_attr.cap.max_inline_data);
+
+        if (qp == nullptr) {
+            detach_cqs();
+            HB_CLOGGER->warn("QP({}) not created, the device refused it: {}", name, std::strerror(errno));
+            return;
+        }
 
-        qp = ibv_create_qp(inv_pd->get_pd(), &init_qp_attr);
         uintptr_t qp_addr = reinterpret_cast<uintptr_t>(qp);
 
-        assert(qp != nullptr);
-
-        HB_CLOGGER->info("New QP({}, 0x{:x}), at {} state\n\tDetail - {}, {}, {}, {}, {}", 
-            name, qp_addr, query_state(),
-            init_qp_attr.cap.max_send_wr, init_qp_attr.cap.max_recv_wr,
-            init_qp_attr.cap.max_send_sge, init_qp_attr.cap.max_recv_sge,
-            init_qp_attr.cap.max_inline_data
-            );
-
-        assert(qp != nullptr);
+        cap = init_qp_attr.cap;
+        psn = profile->sq_psn;
+        psn_known = true;
+
+        if (!quiet)
+            HB_CLOGGER->info("New QP({}, 0x{:x}), at {} state\n\tDetail - {}, {}, {}, {}, {}", 
+                name, qp_addr, query_state(),
+                init_qp_attr.cap.max_send_wr, init_qp_attr.cap.max_recv_wr,
+                init_qp_attr.cap.max_send_sge, init_qp_attr.cap.max_recv_sge,
+                init_qp_attr.cap.max_inline_data
+                );
     }
     else {
         // If involved pd is nullptr, then it is manually generating this container.
@@ -91,10 +123,92 @@ hartebeest::Qp::Qp(const char* id, enum ibv_qp_type connect_type, hartebeest::Pd
     }
 }
 
+// Send WRs complete on the send CQ, recv WRs on the recv CQ. Either may
+// be missing for XRC, and a CQ not made by BasicCq is not counted.
+bool hartebeest::Qp::attach_cqs(struct ibv_cq* sq, struct ibv_cq* rq, const struct ibv_qp_cap& qp_cap) {
+
+    hartebeest::BasicCq* send_cq = hartebeest::BasicCq::of(sq);
+    hartebeest::BasicCq* recv_cq = hartebeest::BasicCq::of(rq);
+
+    if (send_cq != nullptr) {
+        if (send_cq->attach(qp_cap.max_send_wr).ret_code != CQ_RETCODE_ATTACH_OK)
+            return false;
+
+        send_cq_ln = send_cq;
+        send_cq_wrs = qp_cap.max_send_wr;
+    }
+
+    if (recv_cq != nullptr) {
+        if (recv_cq->attach(qp_cap.max_recv_wr).ret_code != CQ_RETCODE_ATTACH_OK) {
+            detach_cqs();
+            return false;
+        }
+
+        recv_cq_ln = recv_cq;
+        recv_cq_wrs = qp_cap.max_recv_wr;
+    }
+
+    return true;
+}
+
+void hartebeest::Qp::detach_cqs() {
+    if (send_cq_ln != nullptr)
+        send_cq_ln->detach(send_cq_wrs);
+
+    if (recv_cq_ln != nullptr)
+        recv_cq_ln->detach(recv_cq_wrs);
+
+    send_cq_ln = recv_cq_ln = nullptr;
+}
+
+// XRC send QPs live in the Pd and have no receive queue. XRC recv QPs live
+// in the HCA's XRC domain and have no queues at all; the SRQs do the receiving.
+void hartebeest::Qp::create_xrc(hartebeest::Pd* inv_pd, struct ibv_cq* sq, struct ibv_qp_init_attr& init_qp_attr) {
+
+    struct ibv_qp_init_attr_ex init_qp_attr_ex;
+    std::memset(&init_qp_attr_ex, 0, sizeof(struct ibv_qp_init_attr_ex));
+
+    init_qp_attr_ex.qp_type = conn_type;
+
+    if (conn_type == IBV_QPT_XRC_SEND) {
+        assert(sq != nullptr);
+
+        init_qp_attr_ex.cap.max_send_wr = init_qp_attr.cap.max_send_wr;
+        init_qp_attr_ex.cap.max_send_sge = init_qp_attr.cap.max_send_sge;
+        init_qp_attr_ex.cap.max_inline_data = init_qp_attr.cap.max_inline_data;
+
+        init_qp_attr_ex.send_cq = sq;
+        init_qp_attr_ex.comp_mask = IBV_QP_INIT_ATTR_PD;
+        init_qp_attr_ex.pd = inv_pd->get_qp_pd();
+    }
+    else {
+        assert(inv_pd->get_hca()->get_xrcd() != nullptr);
+
+        init_qp_attr_ex.comp_mask = IBV_QP_INIT_ATTR_XRCD;
+        init_qp_attr_ex.xrcd = inv_pd->get_hca()->get_xrcd();
+    }
+
+    qp = ibv_create_qp_ex(inv_pd->get_hca()->get_device_ctx(), &init_qp_attr_ex);
+
+    init_qp_attr.qp_type = conn_type;
+    init_qp_attr.cap = init_qp_attr_ex.cap;
+}
+
+bool hartebeest::Qp::is_xrc() const {
+    return (conn_type == IBV_QPT_XRC_SEND || conn_type == IBV_QPT_XRC_RECV);
+}
+
 hartebeest::Qp::~Qp() {
     // HB_CLOGGER->info("Before ~QP({})", name);
-    if (qp != nullptr)
-        ibv_destroy_qp(qp);
+    if (qp != nullptr) {
+        // Remote containers hold a plain copy from unflatten_info().
+        if (pos_type == QP_TYPE_LOCAL)
+            ibv_destroy_qp(qp);
+        else
+            std::free(qp);
+    }
+
+    detach_cqs();
 
     // HB_CLOGGER->info("Destroyed QP({})", name);
 }
@@ -103,6 +217,28 @@ void hartebeest::Qp::set_type(enum hartebeest::QpType qp_type) {
     pos_type = qp_type;
 }
 
+void hartebeest::Qp::set_name(const char* id) {
+    name = std::string(id);
+}
+
+// Another port of the Pd's device, e.g. a rail. Only before INIT.
+void hartebeest::Qp::set_port(const hartebeest::HcaPort& hca_port) {
+    pid = hca_port.port_num;
+    plid = hca_port.lid;
+
+    gid_idx = hca_port.gid_idx;
+    gid = hca_port.gid;
+    active_mtu = hca_port.active_mtu;
+}
+
+const char* hartebeest::Qp::get_name() const {
+    return name.c_str();
+}
+
+enum ibv_qp_type hartebeest::Qp::get_conn_type() const {
+    return conn_type;
+}
+
 bool hartebeest::Qp::is_qp_created() const {
     return (qp != nullptr);
 }
@@ -122,6 +258,27 @@ int hartebeest::Qp::query_state() {
     return query_attr.qp_state;
 }
 
+// Drops the connection. The QP keeps its number and CQs, and can go to INIT again.
+hb_retcode hartebeest::Qp::transit_reset() {
+
+    assert(qp != nullptr);
+    assert(pos_type == QP_TYPE_LOCAL);
+
+    struct ibv_qp_attr qp_attr;
+    std::memset(&qp_attr, 0, sizeof(struct ibv_qp_attr));
+
+    qp_attr.qp_state = IBV_QPS_RESET;
+
+    int ret = ibv_modify_qp(this->qp, &qp_attr, IBV_QP_STATE);
+
+    if (ret != 0) {
+        HB_CLOGGER->warn("Transit RESET QP({}), returned {}, should be 0", name, ret);
+        return hb_retcode(hartebeest::QP_TRANSITION_2_RESET_ERR);
+    }
+
+    return hb_retcode(hartebeest::QP_TRANSITION_2_RESET_OK);
+}
+
 hb_retcode hartebeest::Qp::transit_init() {
 
     assert(qp != nullptr);
@@ -134,12 +291,26 @@ hb_retcode hartebeest::Qp::transit_init() {
     qp_attr.pkey_index = 0;
 
     qp_attr.port_num = pid;
-    qp_attr.qp_access_flags = 
-        IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE;
 
-    int ret = ibv_modify_qp(
-        this->qp, &qp_attr, 
-        IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT | IBV_QP_ACCESS_FLAGS);
+    int init_flags = IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT;
+
+    // Datagrams carry a Q_Key instead of remote access rights.
+    if (conn_type == IBV_QPT_UD) {
+        qp_attr.qkey = profile->qkey;
+        init_flags |= IBV_QP_QKEY;
+    }
+    // UC has no responder for reads, so it only takes remote writes.
+    else if (conn_type == IBV_QPT_UC) {
+        qp_attr.qp_access_flags = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE;
+        init_flags |= IBV_QP_ACCESS_FLAGS;
+    }
+    else {
+        qp_attr.qp_access_flags = 
+            IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ | IBV_ACCESS_REMOTE_WRITE;
+        init_flags |= IBV_QP_ACCESS_FLAGS;
+    }
+
+    int ret = ibv_modify_qp(this->qp, &qp_attr, init_flags);
 
     if (ret != 0) {
         HB_CLOGGER->warn("Transit INIT QP({}), returned {}, should be 0", name, ret);
@@ -158,25 +329,62 @@ hb_retcode hartebeest::Qp::transit_rtr(hartebeest::Qp* remote_qp) {
     std::memset(&conn_attr, 0, sizeof(struct ibv_qp_attr));
 
     conn_attr.qp_state = IBV_QPS_RTR;
-    conn_attr.path_mtu = static_cast<enum ibv_mtu>(get_pref_attr(conn_type, "path_mtu"));
-    conn_attr.rq_psn = get_pref_attr(conn_type, "rq_psn");
+
+    // UD has no remote end at RTR. Peers are addressed per send, by AH.
+    if (conn_type == IBV_QPT_UD) {
+        if (ibv_modify_qp(this->qp, &conn_attr, IBV_QP_STATE) != 0) {
+            HB_CLOGGER->warn("Transit RTR QP({}) failed", name);
+            return hb_retcode(QP_TRANSITION_2_RTR_ERR);
+        }
+
+        return hb_retcode(QP_TRANSITION_2_RTR_OK);
+    }
+
+    conn_attr.path_mtu = profile->path_mtu;
+    if (conn_attr.path_mtu > active_mtu)
+        conn_attr.path_mtu = active_mtu;
+    if (conn_attr.path_mtu > remote_qp->get_active_mtu())
+        conn_attr.path_mtu = remote_qp->get_active_mtu();
+
+    // A peer's own send PSN, when it came with the binary format.
+    conn_attr.rq_psn = remote_qp->is_psn_known() ? 
+        remote_qp->get_psn() : profile->rq_psn;
     conn_attr.dest_qp_num = remote_qp->get_qp()->qp_num;
 
-    conn_attr.ah_attr.is_global = get_pref_attr(conn_type, "ah_attr.is_global");
-    conn_attr.ah_attr.sl = get_pref_attr(conn_type, "ah_attr.sl");
-    conn_attr.ah_attr.src_path_bits = get_pref_attr(conn_type, "ah_attr.src_path_bits");
+    conn_attr.ah_attr.is_global = profile->is_global;
+    conn_attr.ah_attr.sl = profile->sl;
+    conn_attr.ah_attr.src_path_bits = profile->src_path_bits;
     
-    conn_attr.ah_attr.port_num = remote_qp->get_pid();
+    // Port is ours; the remote is addressed by LID, or by GID over RoCE.
+    conn_attr.ah_attr.port_num = pid;
     conn_attr.ah_attr.dlid = remote_qp->get_plid();
 
-    conn_attr.max_dest_rd_atomic =  get_pref_attr(conn_type, "max_dest_rd_atomic");
-    conn_attr.min_rnr_timer =  get_pref_attr(conn_type, "min_rnr_timer");
+    if (is_global() || remote_qp->is_global()) {
+        int flow_label = profile->flow_label;
 
-    HB_CLOGGER->info("Connecting to: qpn {:x}, pid {:x}, plid {:x}", conn_attr.dest_qp_num, conn_attr.ah_attr.port_num, conn_attr.ah_attr.dlid);
+        conn_attr.ah_attr.is_global = 1;
+        conn_attr.ah_attr.grh.dgid = remote_qp->get_gid();
+        conn_attr.ah_attr.grh.sgid_index = (gid_idx >= 0) ? gid_idx : 0;
+        conn_attr.ah_attr.grh.hop_limit = profile->hop_limit;
+        conn_attr.ah_attr.grh.traffic_class = profile->traffic_class;
+        conn_attr.ah_attr.grh.flow_label = (flow_label >= 0) ? 
+            static_cast<uint32_t>(flow_label) : make_flow_label(qp->qp_num, conn_attr.dest_qp_num);
+    }
+
+    if (!quiet)
+        HB_CLOGGER->info("Connecting to: qpn {:x}, pid {:x}, plid {:x}", conn_attr.dest_qp_num, conn_attr.ah_attr.port_num, conn_attr.ah_attr.dlid);
 
     int rtr_flags = 
-        IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU | IBV_QP_DEST_QPN |
-        IBV_QP_RQ_PSN | IBV_QP_MAX_DEST_RD_ATOMIC | IBV_QP_MIN_RNR_TIMER;
+        IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU | IBV_QP_DEST_QPN | IBV_QP_RQ_PSN;
+
+    // Only reliable responders take these. UC and XRC send QPs never ACK 
+    // or serve reads, and reject them.
+    if (conn_type == IBV_QPT_RC || conn_type == IBV_QPT_XRC_RECV) {
+        conn_attr.max_dest_rd_atomic =  profile->max_dest_rd_atomic;
+        conn_attr.min_rnr_timer =  profile->min_rnr_timer;
+
+        rtr_flags |= IBV_QP_MAX_DEST_RD_ATOMIC | IBV_QP_MIN_RNR_TIMER;
+    }
 
     int ret = ibv_modify_qp(
         this->qp, &conn_attr, rtr_flags);
@@ -198,17 +406,21 @@ hb_retcode hartebeest::Qp::transit_rts() {
     std::memset(&conn_attr, 0, sizeof(struct ibv_qp_attr));
 
     conn_attr.qp_state = IBV_QPS_RTS;
-    conn_attr.sq_psn = get_pref_attr(conn_type, "sq_psn");
+    conn_attr.sq_psn = psn;
+
+    int rts_flags = IBV_QP_STATE | IBV_QP_SQ_PSN;
 
-    conn_attr.timeout = get_pref_attr(conn_type, "timeout");
-    conn_attr.retry_cnt = get_pref_attr(conn_type, "retry_cnt");
-    conn_attr.rnr_retry = get_pref_attr(conn_type, "rnr_retry");
-    conn_attr.max_rd_atomic = get_pref_attr(conn_type, "max_rd_atomic");
-    conn_attr.max_dest_rd_atomic = get_pref_attr(conn_type, "max_dest_rd_atomic");
+    // Retransmission and outstanding reads only exist on reliable transports.
+    // UC and UD stop at the send PSN.
+    if (conn_type != IBV_QPT_UC && conn_type != IBV_QPT_UD) {
+        conn_attr.timeout = profile->timeout;
+        conn_attr.retry_cnt = profile->retry_cnt;
+        conn_attr.rnr_retry = profile->rnr_retry;
+        conn_attr.max_rd_atomic = profile->max_rd_atomic;
 
-    int rts_flags = 
-        IBV_QP_STATE | IBV_QP_SQ_PSN | IBV_QP_TIMEOUT |
-        IBV_QP_RETRY_CNT | IBV_QP_RNR_RETRY | IBV_QP_MAX_QP_RD_ATOMIC;
+        rts_flags |= 
+            IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT | IBV_QP_RNR_RETRY | IBV_QP_MAX_QP_RD_ATOMIC;
+    }
 
     int ret = ibv_modify_qp(
         this->qp, &conn_attr, rts_flags);
@@ -233,6 +445,35 @@ uint16_t hartebeest::Qp::get_plid() {
     return plid;
 }
 
+const union ibv_gid& hartebeest::Qp::get_gid() {
+    return gid;
+}
+
+bool hartebeest::Qp::is_global() {
+    return (gid.global.subnet_prefix != 0 || gid.global.interface_id != 0);
+}
+
+enum ibv_mtu hartebeest::Qp::get_active_mtu() {
+    return active_mtu;
+}
+
+// UD only. The Q_Key of the profile this QP was made from; 0 for remotes.
+uint32_t hartebeest::Qp::get_qkey() {
+    return (profile != nullptr) ? profile->qkey : 0;
+}
+
+uint32_t hartebeest::Qp::get_psn() {
+    return psn;
+}
+
+bool hartebeest::Qp::is_psn_known() {
+    return psn_known;
+}
+
+const struct ibv_qp_cap& hartebeest::Qp::get_cap() {
+    return cap;
+}
+
 std::string hartebeest::Qp::flatten_info() {
     std::ostringstream stream;
 
@@ -245,6 +486,13 @@ std::string hartebeest::Qp::flatten_info() {
         << static_cast<int>(pid) << ":"
         << plid << ":"
         << connect_type;
+
+    // GID travels as 32 hex digits, only when there is one.
+    if (is_global()) {
+        stream << ":";
+        for (int i = 0; i < 16; i++)
+            stream << std::setw(2) << std::setfill('0') << static_cast<int>(gid.raw[i]);
+    }
     
     return stream.str();
 }
@@ -271,5 +519,57 @@ void hartebeest::Qp::unflatten_info(const char* fetch) {
     // Assuming port number do not overflow.
     pid = large_pid;
     conn_type = static_cast<enum ibv_qp_type>(large_conn_type);
+
+    std::string gid_str;
+    if ((stream >> gid_str) && gid_str.size() == 32) {
+        for (int i = 0; i < 16; i++)
+            gid.raw[i] = static_cast<uint8_t>(std::stoi(gid_str.substr(i * 2, 2), nullptr, 16));
+    }
 }
 
+
+void hartebeest::Qp::encode_wire(hartebeest::WireWriter& writer) {
+    assert(qp != nullptr);
+
+    WireQp* rec = reinterpret_cast<WireQp*>(writer.append(WIRE_KIND_QP, name.c_str(), sizeof(WireQp)));
+
+    rec->qp_num = qp->qp_num;
+    rec->psn = psn;
+    rec->max_send_wr = cap.max_send_wr;
+    rec->max_recv_wr = cap.max_recv_wr;
+    rec->max_inline_data = cap.max_inline_data;
+    rec->lid = plid;
+    rec->port = pid;
+    rec->conn_type = conn_type;
+    rec->mtu = active_mtu;
+    rec->gid_idx = gid_idx;
+
+    std::memcpy(rec->gid, gid.raw, sizeof(rec->gid));
+}
+
+// Same as Mr::decode_wire(), an ibv_qp copy for get_qp()->qp_num users.
+void hartebeest::Qp::decode_wire(const hartebeest::WireQp* rec) {
+    assert(qp == nullptr);
+    assert(rec->rec.kind == WIRE_KIND_QP);
+
+    qp = reinterpret_cast<struct ibv_qp*>(std::malloc(sizeof(struct ibv_qp)));
+    std::memset(qp, 0, sizeof(struct ibv_qp));
+
+    name = wire_name(&rec->rec);
+
+    qp->qp_num = rec->qp_num;
+    psn = rec->psn;
+    psn_known = true;
+
+    cap.max_send_wr = rec->max_send_wr;
+    cap.max_recv_wr = rec->max_recv_wr;
+    cap.max_inline_data = rec->max_inline_data;
+
+    plid = rec->lid;
+    pid = rec->port;
+    conn_type = static_cast<enum ibv_qp_type>(rec->conn_type);
+    active_mtu = static_cast<enum ibv_mtu>(rec->mtu);
+    gid_idx = rec->gid_idx;
+
+    std::memcpy(gid.raw, rec->gid, sizeof(gid.raw));
+}
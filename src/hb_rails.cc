@@ -0,0 +1,228 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_rails.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./includes/hb_retcode.hh"
+#include "./includes/hb_logger.hh"
+
+#include "./includes/hb_rails.hh"
+
+hartebeest::RailSet::RailSet(const char* key) {
+    name = std::string(key);
+}
+
+std::string hartebeest::RailSet::rail_key(const char* kind, int rail_idx) const {
+    return name + "-" + kind + "-" + std::to_string(rail_idx);
+}
+
+hb_retcode hartebeest::RailSet::create(const std::vector<HcaPort>& hca_ports, size_t buflen, int rights, enum ibv_qp_type conn_type) {
+
+    assert(rails.size() == 0);
+    assert(hca_ports.size() > 0);
+
+    uint8_t* buffer = nullptr;
+
+    for (size_t r = 0; r < hca_ports.size(); r++) {
+        Rail rail;
+        rail.hca_port = hca_ports[r];
+
+        Hca& hca_dev = HB_HCA_INITR.get_hca(rail.hca_port.hca_idx);
+
+        std::string pd_key = rail_key("pd", r);
+        std::string cq_key = rail_key("cq", r);
+        std::string mr_key = rail_key("mr", r);
+        std::string qp_key = rail_key("qp", r);
+
+        rail.pd = new Pd(pd_key.c_str(), hca_dev);
+        if (HB_PD_CACHE.register_resrc(pd_key.c_str(), rail.pd).ret_code != CACHE_RETCODE_REGISTER_OK) {
+            delete rail.pd;
+            unwind();
+            return hb_retcode(RAIL_RETCODE_CREATE_ERR);
+        }
+
+        rail.cq = new BasicCq(cq_key.c_str(), hca_dev);
+        if (HB_BASICCQ_CACHE.register_resrc(cq_key.c_str(), rail.cq).ret_code != CACHE_RETCODE_REGISTER_OK) {
+            delete rail.cq;
+            rail.cq = nullptr;
+        }
+
+        // From here on, a failure takes this rail down with the others.
+        rails.push_back(rail);
+        Rail& added = rails.back();
+
+        if (added.cq == nullptr) {
+            unwind();
+            return hb_retcode(RAIL_RETCODE_CREATE_ERR);
+        }
+
+        // The first rail owns the buffer, the others register it again.
+        hb_retcode ret = (r == 0) ?
+            added.pd->create_mr(mr_key.c_str(), buflen, rights) :
+            added.pd->create_mr(mr_key.c_str(), buffer, buflen, rights);
+
+        if (ret.ret_code != PD_RETCODE_CREATE_MR_OK) {
+            unwind();
+            return hb_retcode(RAIL_RETCODE_CREATE_ERR);
+        }
+
+        added.mr = added.pd->get_mr_cache().get_resrc(mr_key.c_str());
+        if (r == 0)
+            buffer = added.mr->get_buffer();
+
+        ret = added.pd->create_qp(qp_key.c_str(), conn_type, added.cq->get_cq(), added.cq->get_cq());
+        if (ret.ret_code != PD_RETCODE_CREATE_QP_OK) {
+            unwind();
+            return hb_retcode(RAIL_RETCODE_CREATE_ERR);
+        }
+
+        added.qp = added.pd->get_qp_cache().get_resrc(qp_key.c_str());
+        added.qp->set_port(added.hca_port);
+
+        if (added.qp->transit_init().ret_code != QP_TRANSITION_2_INIT_OK) {
+            unwind();
+            return hb_retcode(RAIL_RETCODE_CREATE_ERR);
+        }
+    }
+
+    return hb_retcode(RAIL_RETCODE_CREATE_OK);
+}
+
+// Takes back what a failed create() registered. Last rail first, since
+// the others borrow rail 0's buffer, and each Pd before its CQ.
+void hartebeest::RailSet::unwind() {
+
+    for (size_t r = rails.size(); r-- > 0; ) {
+        Rail& rail = rails[r];
+
+        HB_PD_CACHE.deregister_resrc(rail_key("pd", r).c_str());
+        delete rail.pd;
+
+        HB_BASICCQ_CACHE.deregister_resrc(rail_key("cq", r).c_str());
+        delete rail.cq;
+    }
+
+    rails.clear();
+}
+
+const char* hartebeest::RailSet::get_name() const {
+    return name.c_str();
+}
+
+size_t hartebeest::RailSet::get_n_rails() const {
+    return rails.size();
+}
+
+hartebeest::Rail& hartebeest::RailSet::get_rail(int rail_idx) {
+    return rails.at(rail_idx);
+}
+
+// Stripes go round-robin over rails. Each rail keeps at most `window`
+// writes in flight, and the call returns when every stripe has completed.
+// After a failure nothing more is posted, but the stripes already in flight
+// are drained, so none of their completions are left for the next call.
+hb_retcode hartebeest::RailSet::write_striped(size_t offset, size_t len, size_t stripe_len, int window) {
+
+    assert(stripe_len > 0);
+    assert(window > 0);
+
+    size_t n_rails = rails.size();
+    size_t n_stripes = (len + stripe_len - 1) / stripe_len;
+
+    for (auto& rail: rails)
+        assert((rail.remote_mr != nullptr) && (rail.remote_qp != nullptr));
+
+    std::vector<size_t> next_stripe(n_rails);
+    std::vector<int> in_flight(n_rails, 0);
+
+    for (size_t r = 0; r < n_rails; r++)
+        next_stripe[r] = r;
+
+    size_t n_done = 0;
+    bool failed = false;
+    struct ibv_wc wcs[16];
+
+    while (true) {
+        int n_outstanding = 0;
+        for (auto n: in_flight)
+            n_outstanding += n;
+
+        if (failed ? (n_outstanding == 0) : (n_done == n_stripes))
+            break;
+
+        for (size_t r = 0; r < n_rails; r++) {
+            Rail& rail = rails[r];
+
+            while (!failed && (in_flight[r] < window) && (next_stripe[r] < n_stripes)) {
+                size_t stripe = next_stripe[r];
+                size_t stripe_off = offset + stripe * stripe_len;
+                size_t this_len = (stripe_off + stripe_len > offset + len) ?
+                    (offset + len - stripe_off) : stripe_len;
+
+                struct ibv_send_wr work_req;
+                struct ibv_sge sg_elem;
+                struct ibv_send_wr* bad_work_req = nullptr;
+
+                std::memset(&sg_elem, 0, sizeof(sg_elem));
+                std::memset(&work_req, 0, sizeof(work_req));
+
+                sg_elem.addr = reinterpret_cast<uintptr_t>(rail.mr->get_buffer()) + stripe_off;
+                sg_elem.length = this_len;
+                sg_elem.lkey = rail.mr->get_mr()->lkey;
+
+                work_req.wr_id = stripe;
+                work_req.num_sge = 1;
+                work_req.opcode = IBV_WR_RDMA_WRITE;
+                work_req.send_flags = IBV_SEND_SIGNALED;
+                work_req.sg_list = &sg_elem;
+                work_req.next = nullptr;
+
+                work_req.wr.rdma.remote_addr =
+                    reinterpret_cast<uintptr_t>(rail.remote_mr->get_mr()->addr) + stripe_off;
+                work_req.wr.rdma.rkey = rail.remote_mr->get_mr()->rkey;
+
+                if (ibv_post_send(rail.qp->get_qp(), &work_req, &bad_work_req) != 0) {
+                    HB_CLOGGER->warn("Rail {} post failed at stripe {}", r, stripe);
+                    failed = true;
+                    break;
+                }
+
+                in_flight[r]++;
+                next_stripe[r] += n_rails;
+            }
+
+            if (in_flight[r] == 0)
+                continue;
+
+            int nwc = ibv_poll_cq(rail.cq->get_cq(), 16, wcs);
+
+            // The CQ itself is broken, its outstanding stripes are lost.
+            if (nwc < 0) {
+                HB_CLOGGER->warn("Rail {} CQ poll failed: {}", r, nwc);
+                failed = true;
+                in_flight[r] = 0;
+                continue;
+            }
+
+            // Later stripes on a broken QP come back flushed, only the first is told.
+            for (int i = 0; i < nwc; i++) {
+                if (wcs[i].status != IBV_WC_SUCCESS && !failed) {
+                    HB_CLOGGER->warn("Rail {} stripe {} returned: {}", r, wcs[i].wr_id, wcs[i].status);
+                    failed = true;
+                }
+            }
+
+            in_flight[r] -= nwc;
+            n_done += nwc;
+        }
+    }
+
+    return hb_retcode(failed ? RAIL_RETCODE_WRITE_ERR : RAIL_RETCODE_WRITE_OK);
+}
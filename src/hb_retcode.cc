@@ -17,14 +17,17 @@ namespace hartebeest {
         "HCA: DEVICE OPEN OK"                   ,
         "HCA: DEVICE OPEN ERROR"                ,
         "HCA: DEVICE REGISTER OK"               ,
+        "HCA: XRC DOMAIN OK"                    ,
+        "HCA: XRC DOMAIN ERROR"                 ,
 
         "HCAINITR: DEVICE OPEN OK"              ,
         "HCAINITR: DEVICE LIST RANGE ERROR"     ,
         "HCAINITR: NO DEVICE FOUND ERROR"       ,
         "HCAINITR: NO HCA CONTEXT FOUND ERROR"  ,
         "HCAINITR: PORT QUERY ERROR"            ,
-        "HCAINITR: NOT INFINIBAND LAYER"        ,
+        "HCAINITR: UNSUPPORTED LINK LAYER"      ,
         "HCAINITR: PORT BINDING OK"             ,
+        "HCAINITR: NO USABLE GID ERROR"         ,
 
         "CACHE: ALREADY REGISTERD"              ,
         "CACHE: RESRC NOT FOUND"                ,
@@ -35,6 +38,14 @@ namespace hartebeest {
         "PD: ib_reg_mr ERROR"                   ,
         "PD: QP CREATE ERROR"                   ,
         "PD: QP CREATE OK"                      ,
+        "PD: MW CREATE ERROR"                   ,
+        "PD: MW CREATE OK"                      ,
+        "PD: QP POOL OK"                        ,
+        "PD: QP POOL ERROR"                     ,
+        "PD: THREAD DOMAIN OK"                  ,
+        "PD: THREAD DOMAIN ERROR"               ,
+        "PD: XRC SRQ CREATE OK"                 ,
+        "PD: XRC SRQ CREATE ERROR"              ,
 
         "CFGLDR: CONFIGURATION FILE NOT FOUND"  ,
         "CFGLDR: ENVVAR NOT FOUND"              ,
@@ -42,6 +53,8 @@ namespace hartebeest {
         "CFGLDR: JSON PARSER THROW"             ,
         "CFGLDR: KEY NOT FOUND"                 ,
         
+        "QP: TRANSITION TO RESET OK"            ,
+        "QP: TRANSITION TO RESET ERROR"         ,
         "QP: TRANSITION TO INIT OK"             ,
         "QP: TRANSITION TO INIT ERROR"          ,
         "QP: TRANSITION TO RTR OK"              ,
@@ -49,6 +62,19 @@ namespace hartebeest {
         "QP: TRANSITION TO RTS OK"              ,
         "QP: TRANSITION TO RTS ERROR"           ,
 
+        "MW: BIND OK"                           ,
+        "MW: BIND ERROR"                        ,
+        "MW: INVALIDATE OK"                     ,
+        "MW: INVALIDATE ERROR"                  ,
+
+        "RAIL: SET CREATE OK"                   ,
+        "RAIL: SET CREATE ERROR"                ,
+        "RAIL: STRIPED WRITE OK"                ,
+        "RAIL: STRIPED WRITE ERROR"             ,
+
+        "CQ: ATTACH OK"                         ,
+        "CQ: ATTACH REFUSED"                    ,
+
 
         "MEMCACHED: SET OK"                     ,
         "MEMCACHED: SET FAILED"                 ,
@@ -56,6 +82,15 @@ namespace hartebeest {
         "MEMCACHED: GET FAILED"                 ,
         "MEMCACHED: DEL OK"                     ,
         "MEMCACHED: DEL FAILED"                 ,
+        "MEMCACHED: MGET OK"                    ,
+        "MEMCACHED: MGET FAILED"                ,
+        "MEMCACHED: WAIT DEADLINE PASSED"       ,
+        "MEMCACHED: BARRIER OK"                 ,
+        "MEMCACHED: BARRIER FAILED"             ,
+        "MEMCACHED: INCR OK"                    ,
+        "MEMCACHED: INCR FAILED"                ,
+        "MEMCACHED: MSET OK"                    ,
+        "MEMCACHED: MSET FAILED"                ,
         
         "COMPOUND"                                  // x
     };
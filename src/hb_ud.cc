@@ -0,0 +1,86 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_ud.cc
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./includes/hb_cfgldr.hh"
+#include "./includes/hb_qps.hh"
+#include "./includes/hb_ud.hh"
+
+bool hartebeest::AhKey::operator<(const hartebeest::AhKey& other) const {
+    if (lid != other.lid)
+        return (lid < other.lid);
+
+    if (port != other.port)
+        return (port < other.port);
+
+    return (std::memcmp(gid.raw, other.gid.raw, sizeof(gid.raw)) < 0);
+}
+
+hartebeest::AhCache::~AhCache() {
+    clear();
+}
+
+struct ibv_ah* hartebeest::AhCache::get_ah(struct ibv_pd* pd, uint8_t local_pid, int sgid_idx, hartebeest::Qp* remote_qp) {
+
+    assert(remote_qp != nullptr);
+
+    AhKey key;
+    std::memset(&key, 0, sizeof(key));
+
+    key.lid = remote_qp->get_plid();
+    key.port = remote_qp->get_pid();
+    key.gid = remote_qp->get_gid();
+
+    std::lock_guard<std::mutex> guard(cache_lock);
+
+    auto it = ah_cache.find(key);
+    if (it != ah_cache.end())
+        return it->second;
+
+    const QpProfile* profile = HB_CFG_LOADER.get_qp_profile(IBV_QPT_UD);
+
+    struct ibv_ah_attr ah_attr;
+    std::memset(&ah_attr, 0, sizeof(ah_attr));
+
+    ah_attr.dlid = key.lid;
+    ah_attr.sl = profile->sl;
+    ah_attr.src_path_bits = profile->src_path_bits;
+    ah_attr.port_num = local_pid;
+
+    if (remote_qp->is_global()) {
+        ah_attr.is_global = 1;
+        ah_attr.grh.dgid = key.gid;
+        ah_attr.grh.sgid_index = (sgid_idx >= 0) ? sgid_idx : 0;
+        ah_attr.grh.hop_limit = profile->hop_limit;
+        ah_attr.grh.traffic_class = profile->traffic_class;
+    }
+
+    struct ibv_ah* ah = ibv_create_ah(pd, &ah_attr);
+    if (ah == nullptr) {
+        HB_CLOGGER->warn("AH creation failed for lid {:x}, port {}", key.lid, key.port);
+        return nullptr;
+    }
+
+    ah_cache.insert(std::make_pair(key, ah));
+    return ah;
+}
+
+size_t hartebeest::AhCache::get_size() {
+    std::lock_guard<std::mutex> guard(cache_lock);
+    return ah_cache.size();
+}
+
+void hartebeest::AhCache::clear() {
+    std::lock_guard<std::mutex> guard(cache_lock);
+
+    for (auto it: ah_cache)
+        ibv_destroy_ah(it.second);
+
+    ah_cache.clear();
+}
@@ -0,0 +1,97 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_wire.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#include "./includes/hb_logger.hh"
+#include "./includes/hb_wire.hh"
+
+hartebeest::WireWriter::WireWriter() {
+    value.resize(sizeof(WireHeader));
+}
+
+// Returns the zeroed record, rec header filled. Valid until the next append().
+void* hartebeest::WireWriter::append(enum WireKind kind, const char* name, size_t rec_len) {
+
+    assert(rec_len >= sizeof(WireRecord) && rec_len <= UINT16_MAX);
+    assert(n_records < UINT16_MAX);
+
+    size_t name_len = std::strlen(name);
+    if (name_len >= WIRE_NAME_MAX) {
+        HB_CLOGGER->warn("Wire record name {} cut to {} bytes", name, WIRE_NAME_MAX - 1);
+        name_len = WIRE_NAME_MAX - 1;
+    }
+
+    size_t offset = value.size();
+    value.resize(offset + rec_len, 0);
+
+    WireRecord* rec = reinterpret_cast<WireRecord*>(&value[offset]);
+    rec->kind = kind;
+    rec->rec_len = static_cast<uint16_t>(rec_len);
+    std::memcpy(rec->name, name, name_len);
+
+    n_records++;
+    return rec;
+}
+
+size_t hartebeest::WireWriter::get_n_records() const {
+    return n_records;
+}
+
+const std::string& hartebeest::WireWriter::finish() {
+    WireHeader* header = reinterpret_cast<WireHeader*>(&value[0]);
+
+    header->magic = WIRE_MAGIC;
+    header->version = WIRE_VERSION;
+    header->n_records = n_records;
+
+    return value;
+}
+
+hartebeest::WireReader::WireReader(const std::string& fetched) {
+    value = fetched.data();
+    value_len = fetched.size();
+
+    if (is_wire_format(fetched))
+        n_left = reinterpret_cast<const WireHeader*>(value)->n_records;
+}
+
+bool hartebeest::WireReader::is_valid() const {
+    return (value_len >= sizeof(WireHeader)) && 
+        (reinterpret_cast<const WireHeader*>(value)->magic == WIRE_MAGIC);
+}
+
+// nullptr at the end, or at the first record that runs past the value.
+const hartebeest::WireRecord* hartebeest::WireReader::next() {
+    if (n_left == 0)
+        return nullptr;
+
+    if (offset + sizeof(WireRecord) > value_len)
+        return nullptr;
+
+    const WireRecord* rec = reinterpret_cast<const WireRecord*>(value + offset);
+    if (rec->rec_len < sizeof(WireRecord) || offset + rec->rec_len > value_len) {
+        HB_CLOGGER->warn("Truncated wire record at offset {}", offset);
+        n_left = 0;
+        return nullptr;
+    }
+
+    offset += rec->rec_len;
+    n_left--;
+
+    return rec;
+}
+
+// Newer versions keep the header and record framing, so only the magic is checked.
+bool hartebeest::is_wire_format(const std::string& fetched) {
+    return (fetched.size() >= sizeof(WireHeader)) &&
+        (reinterpret_cast<const WireHeader*>(fetched.data())->magic == WIRE_MAGIC);
+}
+
+std::string hartebeest::wire_name(const WireRecord* rec) {
+    return std::string(rec->name, strnlen(rec->name, WIRE_NAME_MAX));
+}
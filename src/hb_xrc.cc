@@ -0,0 +1,108 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_xrc.cc
+ */
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <sstream>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./includes/hb_xrc.hh"
+
+hartebeest::XrcSrq::XrcSrq(
+        const char* key, struct ibv_pd* pd, struct ibv_xrcd* xrcd, struct ibv_cq* cq, const struct ibv_qp_cap& cap
+    ) {
+    name = std::string(key);
+
+    assert(xrcd != nullptr);
+    assert(cq != nullptr);
+
+    struct ibv_srq_init_attr_ex srq_attr;
+    std::memset(&srq_attr, 0, sizeof(srq_attr));
+
+    // Sized like an RC receive queue.
+    srq_attr.attr.max_wr = cap.max_recv_wr;
+    srq_attr.attr.max_sge = cap.max_recv_sge;
+
+    srq_attr.comp_mask = 
+        IBV_SRQ_INIT_ATTR_TYPE | IBV_SRQ_INIT_ATTR_XRCD | 
+        IBV_SRQ_INIT_ATTR_CQ | IBV_SRQ_INIT_ATTR_PD;
+    srq_attr.srq_type = IBV_SRQT_XRC;
+    srq_attr.xrcd = xrcd;
+    srq_attr.cq = cq;
+    srq_attr.pd = pd;
+
+    srq = ibv_create_srq_ex(pd->context, &srq_attr);
+    if (srq == nullptr) {
+        HB_CLOGGER->warn("XRC SRQ creation failed: {}", name);
+        return;
+    }
+
+    if (ibv_get_srq_num(srq, &srqn) != 0)
+        HB_CLOGGER->warn("XRC SRQ({}) number query failed", name);
+
+    HB_CLOGGER->info("New XRC SRQ({}), srqn {:x}", name, srqn);
+}
+
+hartebeest::XrcSrq::~XrcSrq() {
+    if (is_srq_created())
+        ibv_destroy_srq(srq);
+}
+
+bool hartebeest::XrcSrq::is_srq_created() const {
+    return (srq != nullptr);
+}
+
+const char* hartebeest::XrcSrq::get_name() const {
+    return name.c_str();
+}
+
+struct ibv_srq* hartebeest::XrcSrq::get_srq() const {
+    return srq;
+}
+
+uint32_t hartebeest::XrcSrq::get_srqn() const {
+    return srqn;
+}
+
+bool hartebeest::XrcSrq::post_recv(hartebeest::Mr* mr, size_t offset, size_t len, uint64_t work_id) {
+    struct ibv_recv_wr work_req;
+    struct ibv_sge sg_elem;
+    struct ibv_recv_wr* bad_work_req = nullptr;
+
+    std::memset(&sg_elem, 0, sizeof(sg_elem));
+    std::memset(&work_req, 0, sizeof(work_req));
+
+    sg_elem.addr = reinterpret_cast<uintptr_t>(mr->get_buffer()) + offset;
+    sg_elem.length = len;
+    sg_elem.lkey = mr->get_lkey(offset);
+
+    work_req.wr_id = work_id;
+    work_req.num_sge = 1;
+    work_req.sg_list = &sg_elem;
+    work_req.next = nullptr;
+
+    return (ibv_post_srq_recv(srq, &work_req, &bad_work_req) == 0);
+}
+
+// Remotes need only the number, to put in their send work requests.
+std::string hartebeest::XrcSrq::flatten_info() {
+    std::ostringstream stream;
+
+    assert(srq != nullptr);
+    stream
+        << name << ":"
+        << std::hex << srqn;
+
+    return stream.str();
+}
+
+void hartebeest::XrcSrq::encode_wire(hartebeest::WireWriter& writer) {
+    assert(srq != nullptr);
+
+    WireSrq* rec = reinterpret_cast<WireSrq*>(writer.append(WIRE_KIND_SRQ, name.c_str(), sizeof(WireSrq)));
+    rec->srqn = srqn;
+}
@@ -24,23 +24,61 @@ bool hartebeest_memc_wait_general(const char*);
 bool hartebeest_memc_del_general(const char*);
 
 bool hartebeest_create_local_pd(const char*);
+bool hartebeest_create_local_pd_td(const char*);
 
 bool hartebeest_create_local_mr(const char*, const char*, size_t, int);
+bool hartebeest_create_local_mr_parallel(const char*, const char*, size_t, int, int, size_t);
 bool hartebeest_memc_push_local_mr(const char*, const char*, const char*);
 bool hartebeest_memc_fetch_remote_mr(const char*);
+bool hartebeest_memc_fetch_remote_mr_from(const char*, int);
+
+bool hartebeest_create_local_mw(const char*, const char*);
+bool hartebeest_bind_local_mw(const char*, const char*, const char*, const char*, size_t, size_t, int);
+bool hartebeest_invalidate_local_mw(const char*, const char*, const char*);
+bool hartebeest_memc_push_local_mw(const char*, const char*, const char*);
+
+bool hartebeest_open_local_xrcd(const char*);
+bool hartebeest_create_local_xrc_srq(const char*, const char*, const char*);
+bool hartebeest_memc_push_local_xrc_srq(const char*, const char*, const char*);
+uint32_t hartebeest_memc_fetch_remote_srqn(const char*);
 
 bool hartebeest_create_basiccq(const char*);
+bool hartebeest_create_basiccq_td(const char*, const char*);
 
 bool hartebeest_create_local_qp(const char*, const char*, enum ibv_qp_type, const char*, const char*);
+bool hartebeest_create_local_qp_profile(const char*, const char*, enum ibv_qp_type, const char*, const char*, const char*);
 bool hartebeest_init_local_qp(const char*, const char*);
 bool hartebeest_connect_local_qp(const char*, const char*, const char*);
+bool hartebeest_create_local_qp_pool(const char*, int, enum ibv_qp_type, const char*, const char*);
+bool hartebeest_acquire_local_qp(const char*, const char*);
+bool hartebeest_release_local_qp(const char*, const char*);
 bool hartebeest_memc_push_local_qp(const char*, const char*, const char*);
+bool hartebeest_ready_local_ud_qp(const char*, const char*);
+struct ibv_ah* hartebeest_get_remote_ah(const char*, const char*);
 bool hartebeest_memc_fetch_remote_qp(const char*);
 
+bool hartebeest_add_rail(int, uint8_t);
+bool hartebeest_create_rail_set(const char*, size_t, int, enum ibv_qp_type);
+bool hartebeest_memc_push_rail_set(const char*, const char*);
+bool hartebeest_connect_rail_set(const char*, const char*);
+bool hartebeest_rdma_write_striped(const char*, size_t, size_t, size_t, int);
+
+bool hartebeest_connect_all(const char*, const char*, const char*, int);
+bool hartebeest_create_meta_plane(const char*);
+bool hartebeest_arm_rdma_barrier(const char*, const char*, size_t);
+bool hartebeest_barrier(const char*);
+bool hartebeest_create_rdma_directory(const char*, size_t);
+bool hartebeest_arm_rdma_directory(const char*);
+
 bool hartebeest_rdma_post_single_fast(struct ibv_qp*, void*, void*, size_t, 
     enum ibv_wr_opcode, uint32_t, uint32_t, uint64_t);
 bool hartebeest_rdma_post_single_signaled_inline(struct ibv_qp*, void*, void*, size_t, 
     enum ibv_wr_opcode, uint32_t, uint32_t, uint64_t);
+bool hartebeest_rdma_post_ud_send(struct ibv_qp*, struct ibv_ah*, uint32_t, uint32_t, 
+    void*, size_t, uint32_t, uint64_t);
+bool hartebeest_rdma_post_ud_recv(struct ibv_qp*, void*, size_t, uint32_t, uint64_t);
+bool hartebeest_rdma_post_single_xrc(struct ibv_qp*, void*, void*, size_t, 
+    enum ibv_wr_opcode, uint32_t, uint32_t, uint32_t, uint64_t);
 
 bool hartebeest_rdma_poll(const char*);
 bool hartebeest_rdma_send_poll(struct ibv_qp*);
@@ -48,12 +86,19 @@ bool hartebeest_rdma_recv_poll(struct ibv_qp*);
 
 struct ibv_pd* hartebeest_get_local_pd(const char*);
 struct ibv_mr* hartebeest_get_local_mr(const char*, const char*);
-// BasicCq* get_local_basiccq(const char*);
+struct ibv_mw* hartebeest_get_local_mw(const char*, const char*);
+struct ibv_srq* hartebeest_get_local_xrc_srq(const char*, const char*);
+struct ibv_cq* hartebeest_get_local_basiccq(const char*);
+void hartebeest_report_basiccq_usage(const char*);
 struct ibv_qp* hartebeest_get_local_qp(const char*, const char*);
+uint32_t hartebeest_get_local_qp_qkey(const char*, const char*);
 
 struct ibv_mr* hartebeest_get_remote_mr(const char*);
 struct ibv_qp* hartebeest_get_remote_qp(const char*);
 
+struct ibv_qp* hartebeest_get_peer_qp(const char*, int);
+struct ibv_mr* hartebeest_get_peer_mr(const char*, const char*, int);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
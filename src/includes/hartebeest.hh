@@ -5,6 +5,10 @@
  */
 
 #include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
 
 #include <infiniband/verbs.h> // OFED IB verbs
 
@@ -18,20 +22,92 @@
 #include "./hb_mrs.hh"
 #include "./hb_cqs.hh"
 #include "./hb_pds.hh"
+#include "./hb_rails.hh"
+#include "./hb_endpoint.hh"
+#include "./hb_dir.hh"
 
 #include "./hb_memc.hh"
 
 namespace hartebeest {
 
+    // One entry of connect_local_qp_bulk().
+    struct QpConnSpec {
+        std::string pd_key;
+        std::string qp_key;             // Local QP, created if not there
+        std::string local_memc_key;     // Where the local QP is advertised
+        std::string remote_memc_key;    // Peer QP to connect to
+    };
+
+    // Peer selection of connect_all().
+    enum {
+        HB_TOPOLOGY_MESH        = 0         ,   // Everyone to everyone
+        HB_TOPOLOGY_RING                    ,   // Previous and next node id
+        HB_TOPOLOGY_STAR                    ,   // Lowest node id is the hub
+    };
+
     // Funcs
     class HartebeestCore {
     private:
         int nid;
         int hca_idx;
 
+        // Device and port per rail. Rail 0 is hca_idx at the core's port.
+        std::vector<HcaPort> rails;
+
         // Manages remote resources.
         ResourceCache<Mr> remote_mr_cache;
         ResourceCache<Qp> remote_qp_cache;
+
+        ResourceCache<RailSet> rail_set_cache;
+
+        // Metadata plane: RC QPs "<pd_key>-meta-qp-<nid>-<peer>" on their own
+        // CQ "<pd_key>-meta-cq", for the RDMA barrier and directory.
+        struct {
+            std::string pd_key;
+            BasicCq* cq = nullptr;
+            uint64_t wr_id = 0;
+            std::mutex mtx;
+        } meta;
+
+        Qp* get_meta_qp(int);
+        bool meta_poll(uint64_t, size_t, const Backoff&);
+
+        // RDMA barrier, armed once the mesh is up.
+        struct {
+            bool armed = false;
+            std::string pd_key;
+            std::string mr_key;
+            size_t offset = 0;
+            uint64_t gen = 0;
+        } rdma_barrier;
+
+        bool barrier_rdma();
+
+        // RDMA metadata directory, armed once the mesh is up.
+        struct {
+            bool armed = false;
+            std::string pd_key;
+            Directory* local = nullptr;
+            Mr* scratch = nullptr;              // Copy of a peer's entries
+            uint64_t gen = 0;
+            std::mutex mtx;
+        } rdma_dir;
+
+        bool rdma_dir_publish(const std::string&, const std::string&);
+        bool rdma_dir_lookup(int, const std::string&, std::string&, const Backoff&);
+
+        Mr* register_remote_mr(const char*, const std::string&);
+        Qp* register_remote_qp(const char*, const std::string&);
+
+        std::string encode_mr(Mr*);
+        std::string encode_qp(Qp*);
+        Mr* decode_mr(const char*, const std::string&);
+        Qp* decode_qp(const char*, const std::string&);
+        bool register_remote_bundle(const char*, const std::string&, bool = false);
+        bool fetch_bundles_tree(const std::string&, int);
+
+        bool memc_fetch_bulk(const std::vector<std::string>&, 
+            const std::function<void(const std::string&, const std::string&)>&);
         
     public:
         HartebeestCore(int = 0, uint8_t = 1);
@@ -47,24 +123,92 @@ namespace hartebeest {
         void init();
 
         bool create_local_pd(const char*);
+        bool create_local_pd_td(const char*);
 
         // MR interfaces
         bool create_local_mr(const char*, const char*, size_t, int);
+        bool create_local_mr_parallel(const char*, const char*, size_t, int, int = 0, size_t = 0);
         bool memc_push_local_mr(const char*, const char*, const char*);
-        bool memc_fetch_remote_mr(const char*);
+        bool memc_fetch_remote_mr(const char*, int = -1);
+        bool memc_fetch_remote_mrs(const std::vector<std::string>&);
+
+        // MW interfaces
+        bool create_local_mw(const char*, const char*);
+        bool bind_local_mw(const char*, const char*, const char*, const char*, size_t, size_t, int);
+        bool invalidate_local_mw(const char*, const char*, const char*);
+        bool memc_push_local_mw(const char*, const char*, const char*);
+
+        // XRC interfaces
+        bool open_local_xrcd(const char* = nullptr);
+        bool create_local_xrc_srq(const char*, const char*, const char*);
+        bool memc_push_local_xrc_srq(const char*, const char*, const char*);
+        uint32_t memc_fetch_remote_srqn(const char*);
 
         bool create_basiccq(const char*);
+        bool create_basiccq_td(const char*, const char*);
 
-        bool create_local_qp(const char*, const char*, enum ibv_qp_type, const char*, const char*);
+        bool create_local_qp(const char*, const char*, enum ibv_qp_type, const char*, const char*, const char* = nullptr);
         bool init_local_qp(const char*, const char*);
+
+        bool create_local_qp_pool(const char*, int, enum ibv_qp_type, const char*, const char*);
+        bool acquire_local_qp(const char*, const char*);
+        bool release_local_qp(const char*, const char*);
+
         bool connect_local_qp(const char*, const char*, const char*);
         bool memc_push_local_qp(const char*, const char*, const char*);
+
+        // UD interfaces
+        bool ready_local_ud_qp(const char*, const char*);
+        struct ibv_ah* get_remote_ah(const char*, const char*);
         bool memc_fetch_remote_qp(const char*);
+        bool memc_fetch_remote_qps(const std::vector<std::string>&);
+
+        bool memc_push_bundle(const char*, const char*, 
+            const std::vector<std::string>&, const std::vector<std::string>&);
+        bool memc_fetch_remote_bundle(const char*);
+
+        bool connect_local_qp_bulk(const std::vector<QpConnSpec>&, enum ibv_qp_type, 
+            const char*, const char*, int = 4);
+
+        // Per-thread endpoint interfaces
+        std::vector<int> get_peers(int = HB_TOPOLOGY_MESH);
+        bool connect_all(const char*, const char*, const char*, 
+            int = HB_TOPOLOGY_MESH, enum ibv_qp_type = IBV_QPT_RC, int = 4);
+        Qp* get_peer_qp(const char*, int);
+        Mr* get_peer_mr(const char*, const char*, int);
+
+        bool create_meta_plane(const char*);
+        bool arm_rdma_barrier(const char*, const char*, size_t);
+        bool barrier(const char*);
+
+        bool create_rdma_directory(const char*, size_t = 64);
+        bool arm_rdma_directory(const char*);
+        uint64_t rdma_dir_generation(int);
+
+        bool create_endpoint(const char*, int, size_t, enum ibv_qp_type = IBV_QPT_RC);
+        bool memc_push_endpoint(const char*);
+        bool connect_endpoint(int, const char*, const char*);
+        void destroy_endpoint();
+        Endpoint* get_endpoint();
+
+        // Multi-rail interfaces
+        bool add_rail(int, uint8_t = 1);
+        bool create_rail_set(const char*, size_t, int, enum ibv_qp_type = IBV_QPT_RC);
+        bool memc_push_rail_set(const char*, const char*);
+        bool connect_rail_set(const char*, const char*);
+        bool rdma_write_striped(const char*, size_t, size_t, size_t, int = 16);
 
         bool rdma_post_single_fast(struct ibv_qp*, void*, void*, size_t, 
             enum ibv_wr_opcode, uint32_t, uint32_t, uint64_t);
         bool rdma_post_single_signaled_inline(struct ibv_qp*, void*, void*, size_t, 
             enum ibv_wr_opcode, uint32_t, uint32_t, uint64_t);
+        bool rdma_post_ud_send(struct ibv_qp*, struct ibv_ah*, uint32_t, uint32_t, 
+            void*, size_t, uint32_t, uint64_t);
+        bool rdma_post_ud_send(Qp*, struct ibv_ah*, uint32_t, 
+            void*, size_t, uint32_t, uint64_t);
+        bool rdma_post_ud_recv(struct ibv_qp*, void*, size_t, uint32_t, uint64_t);
+        bool rdma_post_single_xrc(struct ibv_qp*, void*, void*, size_t, 
+            enum ibv_wr_opcode, uint32_t, uint32_t, uint32_t, uint64_t);
 
         bool rdma_poll(const char*);
         bool rdma_send_poll(struct ibv_qp*);
@@ -78,12 +222,17 @@ namespace hartebeest {
         // Access 
         Pd* get_local_pd(const char*);
         Mr* get_local_mr(const char*, const char*);
-        // BasicCq* get_local_basiccq(const char*);
+        Mw* get_local_mw(const char*, const char*);
+        XrcSrq* get_local_xrc_srq(const char*, const char*);
+        BasicCq* get_local_basiccq(const char*);
         Qp* get_local_qp(const char*, const char*);
 
         Mr* get_remote_mr(const char*);
         Qp* get_remote_qp(const char*);
 
+        RailSet* get_rail_set(const char*);
+        int get_n_rails();
+
         char* get_sysvar(const char*);
         int get_nid();
 
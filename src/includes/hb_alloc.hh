@@ -11,4 +11,7 @@ namespace hartebeest {
 
     uint8_t* alloc_buffer(size_t, int = 64);
     void free_buffer(uint8_t*);
+
+    // Touches every page with N threads, so that pinning does not fault.
+    void prefault_buffer(uint8_t*, size_t, int = 0);
 }
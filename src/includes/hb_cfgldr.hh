@@ -7,6 +7,7 @@
 
 #include <string>
 #include <map>
+#include <climits>
 
 #include <infiniband/verbs.h>
 #include "./hb_retcode.hh"
@@ -30,10 +31,67 @@ namespace hartebeest {
         struct ConfPair* conf;
     };
 
+    // "auto" in the config file. Only the keys is_auto_attr() accepts take it.
+    const int ATTR_AUTO = INT_MIN;
+
+    enum {
+        TUNE_GOAL_LATENCY       = 0 ,
+        TUNE_GOAL_THROUGHPUT
+    };
+
+    // QpProfile::auto_mask, fields the HCA fills in from its limits.
+    enum {
+        QP_AUTO_SEND_WR         = 0x01,
+        QP_AUTO_RECV_WR         = 0x02,
+        QP_AUTO_SEND_SGE        = 0x04,
+        QP_AUTO_RECV_SGE        = 0x08,
+        QP_AUTO_INLINE          = 0x10
+    };
+
     enum {
         PDEF_CQ_ATTR        = 0 ,
         PDEF_QP_INIT_ATTR       ,
-        PDEF_QP_ATTR
+        PDEF_QP_ATTR            ,
+        PDEF_HCA_ATTR           ,
+        PDEF_EXC_ATTR
+    };
+
+    // RC and XRC share a profile.
+    enum {
+        QP_PROFILE_RC           = 0 ,
+        QP_PROFILE_UC               ,
+        QP_PROFILE_UD               ,
+        QP_PROFILE_N
+    };
+
+    // qp_init_attr and qp_attr of one transport, read once from the flat keys.
+    struct QpProfile {
+        struct ibv_qp_cap cap;
+        uint32_t auto_mask;             // Set fields of cap are 0 until tuned
+
+        enum ibv_mtu path_mtu;
+        uint32_t rq_psn;
+        uint32_t sq_psn;
+
+        uint8_t is_global;
+        uint8_t sl;
+        uint8_t src_path_bits;
+        uint8_t hop_limit;
+        uint8_t traffic_class;
+        int flow_label;                 // -1: per-QP
+
+        uint8_t max_dest_rd_atomic;
+        uint8_t min_rnr_timer;
+        uint8_t timeout;
+        uint8_t retry_cnt;
+        uint8_t rnr_retry;
+        uint8_t max_rd_atomic;
+
+        uint32_t qkey;
+    };
+
+    struct QpProfileSet {
+        struct QpProfile transport[QP_PROFILE_N];
     };
 
     enum {
@@ -50,9 +108,15 @@ namespace hartebeest {
         std::map<std::string, char*> sysvar_cache;
         std::map<std::string, int*> attr_cache;
 
+        // Never shrinks, so handed-out profile pointers stay valid.
+        QpProfileSet default_profiles;
+        std::map<std::string, QpProfileSet> qp_profiles;
+
         bool is_sysvar_cached(const char*);
         bool is_attr_cached(const char*);
 
+        void compile_qp_profiles(const std::map<std::string, int>&, QpProfileSet&);
+
     public:
         ConfigLoader(const char* = "./hb_config.json");
 
@@ -62,6 +126,8 @@ namespace hartebeest {
         char* get_sysvar(const char*);
         int* get_attr(const char*);
 
+        const QpProfile* get_qp_profile(enum ibv_qp_type, const char* = nullptr);
+
         static ConfigLoader& get_instance() {
             static ConfigLoader single_loader;
             return single_loader;
@@ -5,6 +5,7 @@
  */
 
 #include <string>
+#include <mutex>
 
 #include <infiniband/verbs.h> // OFED IB verbs
 
@@ -16,6 +17,14 @@
 
 namespace hartebeest {
 
+    enum {
+        CQ_OVERFLOW_WARN        = 0 ,
+        CQ_OVERFLOW_RESIZE          ,
+        CQ_OVERFLOW_REFUSE
+    };
+
+    // Attached QPs add their queue depths, each WR may complete here once.
+    // Every live BasicCq is registered by its verbs CQ, see of().
     class BasicCq {
     private:
         std::string name;
@@ -23,11 +32,32 @@ namespace hartebeest {
         Hca* hca_ln = nullptr;
         struct ibv_cq* cq = nullptr;
 
+        std::mutex attach_mtx;
+        int n_attached = 0;
+        uint64_t attached_wrs = 0;
+        uint64_t peak_attached_wrs = 0;
+        int n_resized = 0;
+
+        bool grow(uint64_t);
+
     public:
         BasicCq(const char*, Hca&);
+        BasicCq(const char*, Hca&, struct ibv_pd*);   // Through a parent domain
         ~BasicCq();
 
         struct ibv_cq* get_cq();
+        const char* get_name() const;
+
+        hb_retcode attach(uint32_t);
+        void detach(uint32_t);
+
+        int get_depth();
+        int get_n_attached();
+        uint64_t get_attached_wrs();
+        uint64_t get_peak_attached_wrs();
+        void report_usage();
+
+        static BasicCq* of(struct ibv_cq*);
     };
 
     class BasicCqCache : public ResourceCache<BasicCq> {
@@ -0,0 +1,74 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_dir.hh
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/* Directory is a key/value table in a registered region, that peers read
+ * with one-sided RDMA reads once the QPs are up.
+ * - The region is an inbox of one 8-byte generation per participant,
+ *   then n_entries fixed-size entries.
+ * - Only the owner writes its entries. Each entry is guarded by a sequence
+ *   number at both ends: seq_end is odd while the entry changes, and both
+ *   are equal and even when it is stable. A reader keeps a copy only if it
+ *   sees the same even number at both ends.
+ * - A record lives only in its owner's directory, so readers must know
+ *   the owner's node id.
+ * - Peers announce a change by writing their directory generation into
+ *   their slot of our inbox.
+ */
+
+namespace hartebeest {
+
+    const size_t DIR_KEY_MAX = 112;
+    const size_t DIR_VALUE_MAX = 376;
+    const size_t DIR_READ_WINDOW = 4;       // Entries per remote read of a probe run
+
+    struct DirEntry {
+        uint64_t seq_begin;
+        uint32_t key_len;
+        uint32_t value_len;
+        char key[DIR_KEY_MAX];
+        uint8_t value[DIR_VALUE_MAX];
+        uint64_t seq_end;
+    };
+
+    enum DirFind {
+        DIR_FOUND               = 0         ,
+        DIR_NOT_FOUND                       ,
+        DIR_TORN                            ,   // Read while changing, read again
+        DIR_PROBE_ON                        ,   // Run goes on past the copy
+    };
+
+    class Directory {
+    private:
+        uint8_t* base;
+        size_t n_inbox;
+        size_t n_entries;
+
+    public:
+        Directory(uint8_t*, size_t, size_t);
+
+        static size_t region_size(size_t, size_t);
+
+        size_t get_entries_offset() const;
+        size_t get_entries_size() const;
+        size_t get_n_entries() const;
+
+        volatile uint64_t* inbox(size_t);
+
+        // Owner side
+        bool publish(const std::string&, const std::string&);
+        bool lookup(const std::string&, std::string&);
+
+        // Slot a key's probe run starts at.
+        static size_t home(const std::string&, size_t);
+
+        // Looks up in a copy of consecutive entries of a peer's probe run.
+        static enum DirFind find(const uint8_t*, size_t, const std::string&, std::string&);
+    };
+}
@@ -0,0 +1,77 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_endpoint.hh
+ */
+
+#include <string>
+#include <vector>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./hb_retcode.hh"
+#include "./hb_logger.hh"
+
+#include "./hb_hca.hh"
+#include "./hb_cqs.hh"
+#include "./hb_mrs.hh"
+#include "./hb_pds.hh"
+
+/* Endpoint is the share-nothing unit of one worker thread.
+ * - It owns a Pd, a CQ, a QP per peer and a send/recv buffer pair. None of
+ *   them are registered to the global caches.
+ * - Data path calls touch only the endpoint's own members, no map or lock.
+ * - A peer's remote buffer is its recv buffer.
+ */
+
+namespace hartebeest {
+
+    class Endpoint {
+    private:
+        std::string name;
+        bool ready = false;
+
+        Pd* pd = nullptr;
+        BasicCq* cq = nullptr;
+
+        Mr* send_mr = nullptr;
+        Mr* recv_mr = nullptr;
+
+        std::vector<Qp*> qps;
+        std::vector<Qp*> remote_qps;
+        std::vector<Mr*> remote_mrs;
+
+        bool post_one(int, enum ibv_wr_opcode, size_t, size_t, size_t, bool);
+
+    public:
+        Endpoint(const char*, Hca&, int, size_t, enum ibv_qp_type = IBV_QPT_RC, bool = true);
+        ~Endpoint();
+
+        bool is_ready() const;
+        const char* get_name() const;
+        int get_n_peers() const;
+
+        Pd* get_pd();
+        Qp* get_qp(int);
+        struct ibv_cq* get_cq();
+        Mr* get_send_mr();
+        Mr* get_recv_mr();
+
+        // Setup
+        hb_retcode connect(int, Qp*, Mr*);
+
+        // Data path
+        bool post_write(int, size_t, size_t, size_t, bool = true);
+        bool post_read(int, size_t, size_t, size_t, bool = true);
+        bool post_send(int, size_t, size_t, bool = true);
+        bool post_recv(int, size_t, size_t);
+        int poll(int, struct ibv_wc*);
+
+        static Endpoint*& local() {
+            static thread_local Endpoint* thread_endpoint = nullptr;
+            return thread_endpoint;
+        }
+    };
+}
+
+#define HB_LOCAL_ENDPOINT   hartebeest::Endpoint::local()
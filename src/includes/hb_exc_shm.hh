@@ -0,0 +1,80 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_exc_shm.hh
+ */
+
+#include <cstdint>
+#include <string>
+#include <atomic>
+
+#include "./hb_retcode.hh"
+#include "./hb_memc.hh"
+
+/* ShmHandle is an exchanger backend for jobs on a single host.
+ * - Every process maps the named segment "/hartebeest-<port>", the port
+ *   being the one in HARTEBEEST_EXC_IP_PORT. The table needs no setup:
+ *   a fresh, zero-filled segment is an empty table.
+ * - Slots are claimed by CAS and never freed. Values are appended to the
+ *   data area, and a slot points to its latest value with one atomic word.
+ *   Nothing takes a lock.
+ * - Every set bumps a futex word, so wait_get() sleeps until something
+ *   changes instead of polling.
+ * - The last process to leave unlinks the segment.
+ */
+
+namespace hartebeest {
+
+    const size_t SHM_KEY_MAX = 128;
+
+    enum {
+        SHM_SLOT_EMPTY          = 0         ,
+        SHM_SLOT_CLAIMED                    ,   // Key being written
+        SHM_SLOT_READY                      ,
+    };
+
+    struct ShmSlot {
+        std::atomic<uint32_t> state;
+        uint32_t key_len;
+        char key[SHM_KEY_MAX];
+
+        // (offset + 1) << 32 | length of the value, 0 if none.
+        std::atomic<uint64_t> value;
+    };
+
+    struct ShmHeader {
+        std::atomic<uint32_t> seq;              // Futex word, bumped at every set
+        std::atomic<uint32_t> n_attached;
+        std::atomic<uint64_t> data_used;
+    };
+
+    class ShmHandle : public MemcHandle {
+    private:
+        std::string seg_name;
+
+        size_t seg_size = 0;
+        size_t n_slots = 0;
+        size_t data_cap = 0;
+
+        uint8_t* seg = nullptr;
+        ShmHeader* header = nullptr;
+        ShmSlot* slots = nullptr;
+        uint8_t* data = nullptr;
+
+        ShmSlot* find_slot(const char*, bool);
+        bool append_value(const std::string&, uint64_t&);
+        void read_value(uint64_t, std::string&);
+        void publish();
+
+    public:
+        ShmHandle(const std::string&);
+        ~ShmHandle();
+
+        hb_retcode set(const char*, const std::string&, time_t);
+        hb_retcode get(const char*, std::string&);
+        hb_retcode del(const char*);
+        hb_retcode incr(const char*, uint64_t, time_t, uint64_t&);
+
+        hb_retcode wait_get(const char*, std::string&);
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_exc_tcp.hh
+ */
+
+#include <string>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include "./hb_retcode.hh"
+#include "./hb_memc.hh"
+
+/* TcpHandle is an exchanger backend without a Memcached daemon.
+ * - The lowest node id in HARTEBEEST_PARTICIPANTS hosts the store, and
+ *   listens on the port of HARTEBEEST_EXC_IP_PORT. Others connect to that
+ *   address, the host works on its store directly.
+ * - Request: op(1), key length(4), value length(4), key, value.
+ *   Reply: status(1), value length(4), value.
+ * - The store lives as long as the host process, so nothing is left over
+ *   for the next run. The host should leave last, e.g. after a barrier.
+ */
+
+namespace hartebeest {
+
+    enum {
+        TCP_OP_SET              = 1         ,
+        TCP_OP_GET                          ,
+        TCP_OP_DEL                          ,
+        TCP_OP_INCR                         ,   // Value: 8-byte delta
+    };
+
+    enum {
+        TCP_STATUS_OK           = 0         ,
+        TCP_STATUS_NOT_FOUND                ,
+        TCP_STATUS_ERR                      ,
+    };
+
+    class TcpHandle : public MemcHandle {
+    private:
+        std::string host_ip;
+        std::string host_port;
+        bool is_host;
+
+        // Host side
+        std::map<std::string, std::string> store;
+        std::mutex store_mtx;
+
+        int listen_fd = -1;
+        std::thread accept_thread;
+        std::vector<std::thread> conn_threads;
+        std::vector<int> conn_fds;
+        std::mutex conn_mtx;
+        std::atomic<bool> stopping;
+
+        // Client side
+        int server_fd = -1;
+        std::mutex server_mtx;
+
+        uint8_t apply(uint8_t, const std::string&, const std::string&, std::string&);
+        uint8_t request(uint8_t, const std::string&, const std::string&, std::string&);
+
+        bool listen_host();
+        void accept_loop();
+        void serve_conn(int);
+        bool connect_host();
+
+    public:
+        TcpHandle(const std::string&, const std::string&, bool);
+        ~TcpHandle();
+
+        hb_retcode set(const char*, const std::string&, time_t);
+        hb_retcode get(const char*, std::string&);
+        hb_retcode del(const char*);
+        hb_retcode incr(const char*, uint64_t, time_t, uint64_t&);
+    };
+}
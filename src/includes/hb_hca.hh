@@ -6,7 +6,8 @@
  */
 
 #include <memory>
-// #include <vector>
+#include <vector>
+#include <utility>
 #include <infiniband/verbs.h> // OFED IB verbs
 
 #include "./hb_retcode.hh"
@@ -14,15 +15,37 @@
 
 namespace hartebeest {
 
+    // One (device, port) pair, with what a QP needs to be addressed through it.
+    // Several of them may point to the same Hca, e.g. rails on a dual-port HCA.
+    struct HcaPort {
+        int                     hca_idx = 0;
+        uint8_t                 port_num = 1;
+        uint16_t                lid = 0;
+        uint8_t                 link_layer = IBV_LINK_LAYER_INFINIBAND;
+        enum ibv_mtu            active_mtu = IBV_MTU_4096;
+        int                     gid_idx = -1;
+        union ibv_gid           gid{};
+    };
+
     class Hca final {
     private:
         struct ibv_device*      hca_dev = nullptr;
         struct ibv_context*     hca_ctx = nullptr;
         struct ibv_device_attr  hca_attr;
 
+        // XRC domain, shared by processes that open the same file.
+        struct ibv_xrcd*        hca_xrcd = nullptr;
+        int                     hca_xrcd_fd = -1;
+
         uint8_t                 hca_pid;
         uint16_t                hca_plid;
 
+        // RoCE addressing. gid_idx stays -1 on InfiniBand.
+        uint8_t                 hca_link_layer = IBV_LINK_LAYER_INFINIBAND;
+        enum ibv_mtu            hca_active_mtu = IBV_MTU_4096;
+        int                     hca_gid_idx = -1;
+        union ibv_gid           hca_gid;
+
     public:
         Hca();
         Hca(struct ibv_device*);
@@ -31,15 +54,30 @@ namespace hartebeest {
         hb_retcode device_register(struct ibv_device*);
         hb_retcode device_reset();
         hb_retcode device_open();
+        hb_retcode xrcd_open(const char* = nullptr);
 
         struct ibv_context* get_device_ctx();
+        struct ibv_xrcd* get_xrcd();
         struct ibv_device_attr& get_device_attr();
         
         const uint8_t get_device_pid() const;
         const uint16_t get_device_plid() const;
+        const uint8_t get_link_layer() const;
+        const enum ibv_mtu get_active_mtu() const;
+        const int get_gid_idx() const;
+        const union ibv_gid& get_gid() const;
+
+        bool is_roce() const;
+
+        // "auto" config values, from the device limits.
+        void tune_qp_cap(struct ibv_qp_cap&, uint32_t);
+        int tune_cq_depth();
 
         void set_device_pid(uint8_t);
         void set_device_plid(uint16_t);
+        void set_link_layer(uint8_t);
+        void set_active_mtu(enum ibv_mtu);
+        void set_gid(int, const union ibv_gid&);
     };
 
     class HcaInitializer final {
@@ -55,7 +93,13 @@ namespace hartebeest {
         }
 
         hb_retcode open_device(int);
+        hb_retcode query_port(int, uint8_t, HcaPort&);
         hb_retcode bind_port(int, uint8_t);
+        int find_gid_idx(int, uint8_t, int);
+
+        // Opens several (device index, port) pairs, e.g. for rails. Ports are
+        // only queried, the devices keep the port they were bound to.
+        hb_retcode open_devices(const std::vector<std::pair<int, uint8_t>>&, std::vector<HcaPort>&);
 
         const int get_n_hca_devs() const;
         Hca& get_hca(int);
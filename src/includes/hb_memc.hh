@@ -6,27 +6,42 @@
 
 #include <string>
 #include <regex>
+#include <map>
+#include <vector>
+#include <chrono>
 
 #include <libmemcached/memcached.h>
+#include <libmemcached/util.h>
 // https://awesomized.github.io/libmemcached/libmemcached/index.html
 
 #include "./hb_retcode.hh"
 
 namespace hartebeest {
 
-    class MemcHandle {
-    protected:
-        std::string memc_ip{""};
-        std::string memc_port{""};
+    /* Backoff paces every exchanger wait.
+     * - The delay doubles from exc_attr wait.initial_us up to wait.max_us, 
+     *   each spread by +-wait.jitter_pct so waiting nodes do not poll in step.
+     * - expired() turns true after wait.deadline_ms, never if it is 0.
+     */
+    class Backoff {
+    private:
+        std::chrono::steady_clock::time_point start;
 
-        memcached_st* memc_serv_hdl;
+        int64_t delay_us;
+        int64_t max_us;
+        int jitter_pct;
+        int64_t deadline_ms;
+
+        int n_polls = 0;
 
     public:
-        MemcHandle();
-        virtual ~MemcHandle();
+        Backoff();
 
-        virtual hb_retcode set(const char*, const char*) = 0;
-        virtual hb_retcode get(const char*, std::string&) = 0;
+        void wait();
+        bool expired() const;
+
+        int get_n_polls() const;
+        int64_t get_elapsed_ms() const;
     };
 
     enum {
@@ -37,18 +52,93 @@ namespace hartebeest {
         HB_MEMC_KEY_PREF_QPREADY            ,
     };
 
-    class Exchanger : public MemcHandle {
+    // exc_attr backend.type
+    enum {
+        HB_EXC_BACKEND_MEMCACHED    = 0     ,
+        HB_EXC_BACKEND_TCP                  ,
+        HB_EXC_BACKEND_SHM                  ,
+    };
+
+    // An exc_attr value, or the default if it is not set.
+    int get_exc_attr(const char*, int);
+
+    /* MemcHandle is the key/value store behind the Exchanger.
+     * - Each backend implements set, get, del and incr.
+     * - mget and wait_get have generic versions built on get, which a
+     *   backend may replace with something cheaper.
+     */
+    class MemcHandle {
+    public:
+        virtual ~MemcHandle() = default;
+
+        virtual hb_retcode set(const char*, const std::string&, time_t) = 0;
+        virtual hb_retcode get(const char*, std::string&) = 0;
+        virtual hb_retcode del(const char*) = 0;
+
+        // Adds to a counter, created at 0 with the given expiry if missing,
+        // and returns the new value.
+        virtual hb_retcode incr(const char*, uint64_t, time_t, uint64_t&) = 0;
+
+        virtual hb_retcode mget(const std::vector<std::string>&, std::map<std::string, std::string>&);
+        virtual hb_retcode mset(const std::map<std::string, std::string>&, time_t);
+        virtual hb_retcode wait_get(const char*, std::string&);
+    };
+
+    /* Talks to a Memcached server through libmemcached.
+     * - Each call takes a handle from a pool of memc.pool_size, so threads
+     *   never share one.
+     * - The memc.* behaviors are set on the template handle the pool
+     *   clones: binary protocol, TCP_NODELAY, non-blocking I/O, no-reply sets.
+     */
+    class LibmemcHandle : public MemcHandle {
+    private:
+        std::string memc_ip{""};
+        std::string memc_port{""};
+
+        memcached_st* memc_serv_hdl;
+        memcached_pool_st* memc_pool = nullptr;
+        bool noreply = false;
+
+        memcached_st* acquire();
+        void release(memcached_st*);
+
+    public:
+        LibmemcHandle(const std::string&, const std::string&);
+        ~LibmemcHandle();
+
+        hb_retcode set(const char*, const std::string&, time_t);
+        hb_retcode get(const char*, std::string&);
+        hb_retcode del(const char*);
+        hb_retcode incr(const char*, uint64_t, time_t, uint64_t&);
+
+        hb_retcode mget(const std::vector<std::string>&, std::map<std::string, std::string>&);
+        hb_retcode mset(const std::map<std::string, std::string>&, time_t);
+    };
+
+    class Exchanger {
     private:
         std::string nid;
         std::string participants;
-        // MemcHandle();
-        // ~MemcHandle();
+
+        std::map<std::string, uint64_t> barrier_gens;
+
+        // Picked by exc_attr backend.type.
+        MemcHandle* backend = nullptr;
+
+        // Every key is stored as "e<epoch>:<key>", none if the epoch is 0.
+        uint64_t epoch = 0;
+        std::string epoch_tag{""};
+        time_t key_expire = 0;
+
+        uint64_t agree_epoch();
+        std::string tag(const char*) const;
 
     public:
         Exchanger();
         ~Exchanger();
 
         hb_retcode set(const char*, const char*);
+        hb_retcode set(const char*, const std::string&);    // Binary safe
         hb_retcode get(const char*, std::string&);
 
         hb_retcode prefix_set(const char*, const int, const char*);
@@ -56,6 +146,20 @@ namespace hartebeest {
 
         hb_retcode del(const char*);
 
+        // HARTEBEEST_PARTICIPANTS as node ids, sorted.
+        std::vector<int> get_participants() const;
+
+        hb_retcode mget(const std::vector<std::string>&, std::map<std::string, std::string>&);
+        hb_retcode mset(const std::map<std::string, std::string>&);
+
+        // Waits until the key shows up or the deadline passes.
+        hb_retcode wait_get(const char*, std::string&);
+
+        hb_retcode barrier(const char*, int);
+
+        MemcHandle* get_backend();
+        uint64_t get_epoch() const;
+
         static Exchanger& get_instance() {
             static Exchanger exchgr;
             return exchgr;
@@ -11,6 +11,7 @@
 
 #include "./hb_retcode.hh"
 #include "./hb_logger.hh"
+#include "./hb_wire.hh"
 
 namespace hartebeest {
 
@@ -26,11 +27,20 @@ namespace hartebeest {
         enum MrType type = MR_TYPE_LOCAL;
 
         uint8_t* buffer = nullptr;
+        bool own_buffer = true;
+        size_t length = 0;
         struct ibv_mr* mr = nullptr;
 
+        // Chunked registration. One logical Mr, several ibv_mr underneath.
+        size_t chunk_len = 0;
+        std::vector<struct ibv_mr*> chunk_mrs;
+        std::vector<uint32_t> chunk_lkeys;
+        std::vector<uint32_t> chunk_rkeys;
+
     public:
-        Mr(size_t);
-        Mr(const char*, size_t);
+        Mr(size_t, size_t = 64);
+        Mr(const char*, size_t, size_t = 64);
+        Mr(const char*, uint8_t*, size_t);    // Borrowed buffer
         ~Mr();
 
         bool is_allocated() const;
@@ -38,12 +48,23 @@ namespace hartebeest {
         
         const char* get_name() const;
         uint8_t* get_buffer() const;
+        size_t get_length() const;
         struct ibv_mr* get_mr() const;
 
+        bool is_chunked() const;
+        size_t get_n_chunks() const;
+        size_t get_chunk_len() const;
+        uint32_t get_lkey(size_t = 0) const;
+        uint32_t get_rkey(size_t = 0) const;
+
         void set_mr(struct ibv_mr*);
+        void set_chunks(std::vector<struct ibv_mr*>&, size_t);
         void set_type(enum MrType);
 
         std::string flatten_info();
         void unflatten_info(const char*);
+
+        void encode_wire(WireWriter&);
+        void decode_wire(const WireMr*);
     };
 }
\ No newline at end of file
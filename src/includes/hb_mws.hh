@@ -0,0 +1,51 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_mws.hh
+ */
+
+#include <string>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./hb_retcode.hh"
+#include "./hb_logger.hh"
+
+#include "./hb_mrs.hh"
+
+/* Mw wraps a type-2 memory window.
+ * - A window is allocated once per Pd, then bound/invalidated on the data path
+ *   with a single work request. The bound rkey is advertised like an MR's.
+ */
+
+namespace hartebeest {
+
+    class Mw {
+    private:
+        std::string name;
+
+        struct ibv_mw* mw = nullptr;
+
+        // Currently bound range. rkey changes at every bind.
+        uintptr_t bound_addr = 0;
+        size_t bound_len = 0;
+        uint32_t bound_rkey = 0;
+        bool bound = false;
+
+    public:
+        Mw(const char*, struct ibv_pd*);
+        ~Mw();
+
+        bool is_mw_created() const;
+        bool is_bound() const;
+
+        const char* get_name() const;
+        struct ibv_mw* get_mw() const;
+        uint32_t get_rkey() const;
+
+        hb_retcode bind(struct ibv_qp*, Mr*, size_t, size_t, int, uint64_t = 0);
+        hb_retcode invalidate(struct ibv_qp*, uint64_t = 0);
+
+        std::string flatten_info();
+    };
+}
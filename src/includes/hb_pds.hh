@@ -19,7 +19,10 @@
 #include "./hb_hca.hh"
 #include "./hb_cache.hh"
 #include "./hb_mrs.hh"
+#include "./hb_mws.hh"
 #include "./hb_qps.hh"
+#include "./hb_xrc.hh"
+#include "./hb_ud.hh"
 
 
 namespace hartebeest {
@@ -34,21 +37,53 @@ namespace hartebeest {
         Hca* hca_ln = nullptr;
         struct ibv_pd* pd = nullptr;
 
+        // Thread-bound: QPs and CQs go through the parent domain, lock-free.
+        struct ibv_td* td = nullptr;
+        struct ibv_pd* parent_pd = nullptr;
+
         ResourceCache<Mr> mr_cache;
         ResourceCache<Qp> qp_cache;
+        ResourceCache<Mw> mw_cache;
+        ResourceCache<XrcSrq> srq_cache;
+
+        // UD destinations, shared by every UD QP of this Pd.
+        AhCache ah_cache;
+
+        // Idle QPs, all in INIT. Only QPs of the pool's type and CQs return here.
+        std::vector<Qp*> qp_pool;
+        enum ibv_qp_type pool_conn_type = IBV_QPT_RC;
+        struct ibv_cq* pool_sq = nullptr;
+        struct ibv_cq* pool_rq = nullptr;
 
     public:
         Pd(const char*, Hca&);
         ~Pd();
 
         struct ibv_pd* get_pd();
+        struct ibv_pd* get_qp_pd();
+        struct ibv_td* get_td();
         Hca* get_hca();
 
+        hb_retcode bind_thread_domain();
+        bool is_thread_bound() const;
+
         hb_retcode create_mr(const char*, size_t, int);
-        hb_retcode create_qp(const char*, enum ibv_qp_type, struct ibv_cq*, struct ibv_cq*);
+        hb_retcode create_mr(const char*, uint8_t*, size_t, int);
+        hb_retcode create_mr_parallel(const char*, size_t, int, int, size_t = 0);
+        hb_retcode create_qp(const char*, enum ibv_qp_type, struct ibv_cq*, struct ibv_cq*, const char* = nullptr);
+        hb_retcode create_mw(const char*);
+        hb_retcode create_xrc_srq(const char*, struct ibv_cq*);
+
+        hb_retcode create_qp_pool(int, enum ibv_qp_type, struct ibv_cq*, struct ibv_cq*);
+        hb_retcode acquire_qp(const char*);
+        hb_retcode release_qp(const char*);
+        size_t get_qp_pool_size() const;
         
         ResourceCache<Mr>& get_mr_cache();
         ResourceCache<Qp>& get_qp_cache();
+        ResourceCache<Mw>& get_mw_cache();
+        ResourceCache<XrcSrq>& get_srq_cache();
+        AhCache& get_ah_cache();
     };
 
     class PdCache : public ResourceCache<Pd> {
@@ -11,6 +11,7 @@
 
 #include "./hb_retcode.hh"
 #include "./hb_logger.hh"
+#include "./hb_wire.hh"
 
 #include "./hb_pds.hh"
 
@@ -23,6 +24,9 @@ namespace hartebeest {
     };
 
     class Pd; // Somewhere.
+    class BasicCq;
+    struct QpProfile;
+
     class Qp {
     private:
         std::string name;
@@ -32,27 +36,72 @@ namespace hartebeest {
         struct ibv_qp* qp = nullptr;
         uint8_t pid;
         uint16_t plid;
+
+        // RoCE only. Zero GID means the LID path.
+        int gid_idx = -1;
+        union ibv_gid gid;
+        enum ibv_mtu active_mtu = IBV_MTU_4096;
+
+        // Send PSN, and queue sizes. Known for remotes only from the wire format.
+        uint32_t psn = 0;
+        bool psn_known = false;
+        struct ibv_qp_cap cap;
+
+        // Local only. Keeps per-QP info logs out of bulk setup paths.
+        bool quiet = false;
+
+        // Local only. Compiled attributes of the transport, see ConfigLoader.
+        const QpProfile* profile = nullptr;
+
+        // Local only. The CQs this QP's queue depths are counted on.
+        BasicCq* send_cq_ln = nullptr;
+        BasicCq* recv_cq_ln = nullptr;
+        uint32_t send_cq_wrs = 0;
+        uint32_t recv_cq_wrs = 0;
+
+        bool attach_cqs(struct ibv_cq*, struct ibv_cq*, const struct ibv_qp_cap&);
+        void detach_cqs();
+
+        void create_xrc(Pd*, struct ibv_cq*, struct ibv_qp_init_attr&);
         
     public:
-        Qp(const char*, enum ibv_qp_type, Pd*, struct ibv_cq*, struct ibv_cq*);
+        Qp(const char*, enum ibv_qp_type, Pd*, struct ibv_cq*, struct ibv_cq*, const char* = nullptr, bool = false);
         ~Qp();
 
         void set_type(enum QpType);
+        void set_name(const char*);
+        void set_port(const HcaPort&);
+
+        const char* get_name() const;
+        enum ibv_qp_type get_conn_type() const;
 
         bool is_qp_created() const;
+        bool is_xrc() const;
         int query_state();
 
         // State transition interfaces
+        hb_retcode transit_reset();
         hb_retcode transit_init();
         hb_retcode transit_rtr(Qp*);
         hb_retcode transit_rts();
 
         uint8_t get_pid();
         uint16_t get_plid();
+        const union ibv_gid& get_gid();
+        bool is_global();
+
+        enum ibv_mtu get_active_mtu();
+        uint32_t get_qkey();
+        uint32_t get_psn();
+        bool is_psn_known();
+        const struct ibv_qp_cap& get_cap();
 
         struct ibv_qp* get_qp();
         
         std::string flatten_info();
         void unflatten_info(const char*);
+
+        void encode_wire(WireWriter&);
+        void decode_wire(const WireQp*);
     };
 }
\ No newline at end of file
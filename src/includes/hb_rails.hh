@@ -0,0 +1,63 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_rails.hh
+ */
+
+#include <string>
+#include <vector>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./hb_retcode.hh"
+#include "./hb_logger.hh"
+
+#include "./hb_hca.hh"
+#include "./hb_cqs.hh"
+#include "./hb_pds.hh"
+
+/* RailSet bundles one Pd/Cq/Mr/Qp per opened HCA port (rail).
+ * - A rail is a (device, port) pair. Two rails may share a device, each QP
+ *   is moved to its rail's port before INIT.
+ * - Every rail registers the same buffer, so a stripe lands at the same
+ *   offset whichever rail carries it.
+ * - Resources are registered to the global caches under derived names,
+ *   "<set>-pd-<rail>", "<set>-cq-<rail>", "<set>-mr-<rail>", "<set>-qp-<rail>".
+ */
+
+namespace hartebeest {
+
+    struct Rail {
+        HcaPort hca_port;
+
+        Pd* pd = nullptr;
+        BasicCq* cq = nullptr;
+        Mr* mr = nullptr;
+        Qp* qp = nullptr;
+
+        Mr* remote_mr = nullptr;
+        Qp* remote_qp = nullptr;
+    };
+
+    class RailSet {
+    private:
+        std::string name;
+        std::vector<Rail> rails;
+
+        void unwind();
+
+    public:
+        RailSet(const char*);
+        ~RailSet() = default;
+
+        hb_retcode create(const std::vector<HcaPort>&, size_t, int, enum ibv_qp_type);
+
+        std::string rail_key(const char*, int) const;
+
+        const char* get_name() const;
+        size_t get_n_rails() const;
+        Rail& get_rail(int);
+
+        hb_retcode write_striped(size_t, size_t, size_t, int);
+    };
+}
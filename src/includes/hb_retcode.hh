@@ -17,6 +17,8 @@ namespace hartebeest {
         HCA_RETCODE_OPEN_OK                     ,
         HCA_RETCODE_OPEN_ERR                    ,
         HCA_RETCODE_REGISTER_OK                 ,
+        HCA_RETCODE_XRCD_OK                     ,
+        HCA_RETCODE_XRCD_ERR                    ,
 
         HCAINITR_RETCODE_OPEN_OK                ,
         HCAINITR_RETCODE_RANGE_ERR              ,
@@ -25,6 +27,7 @@ namespace hartebeest {
         HCAINITR_RETCODE_PORT_QUERY_ERR         ,
         HCAINITR_RETCODE_NO_IB                  ,
         HCAINITR_RETCODE_BIND_PORT_OK           ,
+        HCAINITR_RETCODE_NO_GID_ERR             ,
 
         CACHE_RETCODE_ALREADY_EXIST_ERR         ,
         CACHE_RETCODE_NO_EXIST_ERR              ,
@@ -35,6 +38,14 @@ namespace hartebeest {
         PD_RETCODE_IB_REG_MR_ERR                ,
         PD_RETCODE_CREATE_QP_ERR                ,
         PD_RETCODE_CREATE_QP_OK                 ,
+        PD_RETCODE_CREATE_MW_ERR                ,
+        PD_RETCODE_CREATE_MW_OK                 ,
+        PD_RETCODE_QP_POOL_OK                   ,
+        PD_RETCODE_QP_POOL_ERR                  ,
+        PD_RETCODE_ALLOC_TD_OK                  ,
+        PD_RETCODE_ALLOC_TD_ERR                 ,
+        PD_RETCODE_CREATE_SRQ_OK                ,
+        PD_RETCODE_CREATE_SRQ_ERR               ,
 
         CFGLDR_RETCODE_FILE_NOT_FOUND           ,
         CFGLDR_RETCODE_ENVVAR_NOT_FOUND         ,
@@ -42,6 +53,8 @@ namespace hartebeest {
         CFGLDR_JSON_ERR                         ,
         CFGLDR_KEY_NOT_FOUND                    ,
 
+        QP_TRANSITION_2_RESET_OK                ,
+        QP_TRANSITION_2_RESET_ERR               ,
         QP_TRANSITION_2_INIT_OK                 ,
         QP_TRANSITION_2_INIT_ERR                ,
         QP_TRANSITION_2_RTR_OK                  ,
@@ -49,12 +62,34 @@ namespace hartebeest {
         QP_TRANSITION_2_RTS_OK                  ,
         QP_TRANSITION_2_RTS_ERR                 ,
 
+        MW_BIND_OK                              ,
+        MW_BIND_ERR                             ,
+        MW_INVALIDATE_OK                        ,
+        MW_INVALIDATE_ERR                       ,
+
+        RAIL_RETCODE_CREATE_OK                  ,
+        RAIL_RETCODE_CREATE_ERR                 ,
+        RAIL_RETCODE_WRITE_OK                   ,
+        RAIL_RETCODE_WRITE_ERR                  ,
+
+        CQ_RETCODE_ATTACH_OK                    ,
+        CQ_RETCODE_ATTACH_ERR                   ,
+
         MEMCH_SET_OK                            ,
         MEMCH_SET_ERR                           ,
         MEMCH_GET_OK                            ,
         MEMCH_GET_ERR                           ,
         MEMCH_DEL_OK                            ,
         MEMCH_DEL_ERR                           ,
+        MEMCH_MGET_OK                           ,
+        MEMCH_MGET_ERR                          ,
+        MEMCH_WAIT_TIMEOUT_ERR                  ,
+        MEMCH_BARRIER_OK                        ,
+        MEMCH_BARRIER_ERR                       ,
+        MEMCH_INCR_OK                           ,
+        MEMCH_INCR_ERR                          ,
+        MEMCH_MSET_OK                           ,
+        MEMCH_MSET_ERR                          ,
 
         COMPOUND                                // x
     };
@@ -0,0 +1,56 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_ud.hh
+ */
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./hb_retcode.hh"
+#include "./hb_logger.hh"
+
+/* UD helpers.
+ * - A UD QP reaches any peer through an address handle. AhCache keeps one
+ *   AH per destination (lid/gid, port), so peers sharing a node share one.
+ * - Every received datagram starts with a 40-byte GRH slot, present or not.
+ *   Receive buffers must reserve it, and the payload starts after it.
+ */
+
+namespace hartebeest {
+
+    const size_t UD_GRH_BYTES = 40;
+
+    inline uint8_t* ud_payload(void* recv_slot) {
+        return reinterpret_cast<uint8_t*>(recv_slot) + UD_GRH_BYTES;
+    }
+
+    class Qp; // Somewhere.
+
+    struct AhKey {
+        uint16_t lid;
+        uint8_t port;
+        union ibv_gid gid;
+
+        bool operator<(const AhKey&) const;
+    };
+
+    class AhCache {
+    private:
+        std::mutex cache_lock;
+        std::map<AhKey, struct ibv_ah*> ah_cache;
+
+    public:
+        AhCache() = default;
+        ~AhCache();
+
+        // Creates on the first lookup of a destination.
+        struct ibv_ah* get_ah(struct ibv_pd*, uint8_t, int, Qp*);
+
+        size_t get_size();
+        void clear();
+    };
+}
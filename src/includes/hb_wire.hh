@@ -0,0 +1,115 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_wire.hh
+ */
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/* Binary wire format of exchanged MR/QP/SRQ metadata.
+ * - A value is a WireHeader followed by n_records records. Each record starts
+ *   with a WireRecord telling its kind and total length, so a reader skips
+ *   kinds it does not know.
+ * - Records are fixed layout and packed, in host byte order. Participants
+ *   are expected to share it.
+ * - Reading is a cast into the fetched value, nothing is parsed. Mr and Qp
+ *   still copy a record into their remote containers, see decode_wire().
+ * - A chunked MR record is followed by n_chunks rkeys.
+ * - Values without the magic are the old ':'-separated text.
+ */
+
+namespace hartebeest {
+
+    const uint32_t WIRE_MAGIC = 0x31574248;     // "HBW1"
+    const uint16_t WIRE_VERSION = 1;
+    const size_t WIRE_NAME_MAX = 64;            // Including the terminating NUL
+
+    enum WireKind {
+        WIRE_KIND_MR = 1,
+        WIRE_KIND_QP = 2,
+        WIRE_KIND_SRQ = 3
+    };
+
+#pragma pack(push, 1)
+    struct WireHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t n_records;
+    };
+
+    struct WireRecord {
+        uint16_t kind;
+        uint16_t rec_len;           // Including this header and the trailer
+        char name[WIRE_NAME_MAX];
+    };
+
+    struct WireMr {
+        WireRecord rec;
+
+        uint64_t addr;
+        uint64_t length;
+        uint64_t chunk_len;         // 0 if not chunked
+        uint32_t lkey;
+        uint32_t rkey;
+        uint32_t n_chunks;          // rkeys that follow
+    };
+
+    struct WireQp {
+        WireRecord rec;
+
+        uint32_t qp_num;
+        uint32_t psn;               // Send PSN, the peer's receive PSN
+        uint32_t max_send_wr;
+        uint32_t max_recv_wr;
+        uint32_t max_inline_data;
+        uint16_t lid;
+        uint8_t port;
+        uint8_t conn_type;
+        uint8_t mtu;                // Active MTU of the port
+        int8_t gid_idx;
+        uint8_t gid[16];
+    };
+
+    struct WireSrq {
+        WireRecord rec;
+
+        uint32_t srqn;
+    };
+#pragma pack(pop)
+
+    // Builds one value out of any number of records.
+    class WireWriter {
+    private:
+        std::string value;
+        uint16_t n_records = 0;
+
+    public:
+        WireWriter();
+
+        void* append(enum WireKind, const char*, size_t);
+        size_t get_n_records() const;
+
+        const std::string& finish();
+    };
+
+    // Walks the records of a fetched value, in place.
+    class WireReader {
+    private:
+        const char* value;
+        size_t value_len;
+
+        size_t offset = sizeof(WireHeader);
+        uint16_t n_left = 0;
+
+    public:
+        WireReader(const std::string&);
+
+        bool is_valid() const;
+        const WireRecord* next();
+    };
+
+    bool is_wire_format(const std::string&);
+    std::string wire_name(const WireRecord*);
+}
@@ -0,0 +1,47 @@
+#pragma once
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * hb_xrc.hh
+ */
+
+#include <string>
+
+#include <infiniband/verbs.h> // OFED IB verbs
+
+#include "./hb_retcode.hh"
+#include "./hb_logger.hh"
+
+#include "./hb_mrs.hh"
+#include "./hb_wire.hh"
+
+/* XrcSrq is the receive side of an XRC connection.
+ * - One XRC recv QP per remote node feeds every SRQ in the same XRC domain.
+ *   Senders pick the target SRQ per work request, by its SRQ number.
+ * - Receive buffers are posted to the SRQ, never to the QP.
+ */
+
+namespace hartebeest {
+
+    class XrcSrq {
+    private:
+        std::string name;
+
+        struct ibv_srq* srq = nullptr;
+        uint32_t srqn = 0;
+
+    public:
+        XrcSrq(const char*, struct ibv_pd*, struct ibv_xrcd*, struct ibv_cq*, const struct ibv_qp_cap&);
+        ~XrcSrq();
+
+        bool is_srq_created() const;
+
+        const char* get_name() const;
+        struct ibv_srq* get_srq() const;
+        uint32_t get_srqn() const;
+
+        bool post_recv(Mr*, size_t, size_t, uint64_t = 0);
+
+        std::string flatten_info();
+        void encode_wire(WireWriter&);
+    };
+}
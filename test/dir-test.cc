@@ -0,0 +1,69 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * directory test
+ */
+
+#include <cstring>
+#include <vector>
+#include <string>
+
+#include "../extern/spdlog/spdlog.h"
+#include "../src/includes/hartebeest.hh"
+
+// Runs on a plain buffer, no HCA needed.
+int main() {
+
+    HB_CLOGGER->info("-- Directory Test Start --");
+
+    int n_failed = 0;
+    auto check = [&](bool passed, const char* what) {
+        HB_CLOGGER->info("{}: {}", what, passed ? "OK" : "FAILED");
+        if (!passed)
+            n_failed++;
+    };
+
+    const size_t n_inbox = 2;
+    const size_t n_entries = 8;
+
+    std::vector<uint8_t> region(hartebeest::Directory::region_size(n_inbox, n_entries));
+    hartebeest::Directory dir(region.data(), n_inbox, n_entries);
+
+    const hartebeest::DirEntry* entries = 
+        reinterpret_cast<const hartebeest::DirEntry*>(region.data() + dir.get_entries_offset());
+
+    std::string key{"node-0-mr"};
+    std::string value;
+
+    check(!dir.lookup(key, value), "Empty directory misses");
+
+    // Republishing a key rewrites its own entry, and readers see the last value.
+    check(dir.publish(key, "first"), "Publish");
+    check(dir.publish(key, "second"), "Republish");
+
+    size_t home = hartebeest::Directory::home(key, n_entries);
+    const hartebeest::DirEntry* entry = &entries[home];
+
+    check(entry->seq_begin == 4 && entry->seq_end == 4, "Entry stable after two publishes");
+    check(entries[(home + 1) % n_entries].seq_end == 0, "No second entry for the same key");
+
+    check(dir.lookup(key, value) && value == "second", "Owner reads the last value");
+    check(hartebeest::Directory::find(
+        reinterpret_cast<const uint8_t*>(entry), 1, key, value) == hartebeest::DIR_FOUND && value == "second", 
+        "Copy holds the last value");
+
+    // A copy taken mid-publish, with an odd seq_end, is torn.
+    hartebeest::DirEntry torn;
+    std::memcpy(&torn, entry, sizeof(torn));
+    torn.seq_end = 5;
+
+    check(hartebeest::Directory::find(
+        reinterpret_cast<const uint8_t*>(&torn), 1, key, value) == hartebeest::DIR_TORN, "Odd seq_end is torn");
+
+    // Too long a record is left to the exchanger.
+    check(!dir.publish(key, std::string(hartebeest::DIR_VALUE_MAX + 1, 'x')), "Long record refused");
+    check(dir.lookup(key, value) && value == "second", "Refused record leaves the entry");
+
+    HB_CLOGGER->info("-- Directory Test Done, {} failed --", n_failed);
+
+    return (n_failed == 0) ? 0 : 1;
+}
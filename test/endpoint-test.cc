@@ -0,0 +1,95 @@
+/* github.com/sjoon-oh/hartebeest
+ * Author: Sukjoon Oh, sjoon@kaist.ac.kr
+ * endpoint test
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "../extern/spdlog/spdlog.h"
+#include "../src/includes/hartebeest.hh"
+
+// Two nodes, each worker thread owns an endpoint with one peer: 
+// the same worker index on the other node.
+const int N_WORKERS = 4;
+
+// Workers take turns on the exchanger. All pushes land before any worker
+// blocks in a fetch holding the lock.
+std::mutex exchanger_lock;
+std::atomic<int> n_pushed(0);
+
+void worker(int node_id, int widx) {
+
+    int other_id = (node_id == 0) ? 1 : 0;
+
+    std::string ep_name = "ep-" + std::to_string(node_id) + "-" + std::to_string(widx);
+    std::string other_ep_name = "ep-" + std::to_string(other_id) + "-" + std::to_string(widx);
+
+    bool created = HARTEBEEST_CORE_HDL.create_endpoint(ep_name.c_str(), 1, 4096);
+    assert(created);
+    {
+        std::lock_guard<std::mutex> guard(exchanger_lock);
+        HARTEBEEST_CORE_HDL.memc_push_endpoint(ep_name.c_str());
+    }
+
+    n_pushed++;
+    while (n_pushed.load() < N_WORKERS)
+        ;
+
+    {
+        std::lock_guard<std::mutex> guard(exchanger_lock);
+        bool connected = HARTEBEEST_CORE_HDL.connect_endpoint(0, 
+            (other_ep_name + "-qp-0").c_str(), (other_ep_name + "-mr").c_str());
+        assert(connected);
+    }
+
+    hartebeest::Endpoint* endpoint = HARTEBEEST_CORE_HDL.get_endpoint();
+    std::string payload = "PAYLOAD FROM " + ep_name;
+
+    if (node_id == 0) {
+        std::memcpy(endpoint->get_send_mr()->get_buffer(), payload.c_str(), payload.size() + 1);
+        endpoint->post_write(0, 0, 0, payload.size() + 1);
+
+        struct ibv_wc wc;
+        while (endpoint->poll(1, &wc) == 0)
+            ;
+
+        assert(wc.status == IBV_WC_SUCCESS);
+        HB_CLOGGER->info("Worker {} write done", widx);
+    }
+    else {
+        std::string expected = "PAYLOAD FROM " + other_ep_name;
+        char* written = reinterpret_cast<char*>(endpoint->get_recv_mr()->get_buffer());
+
+        while (std::strcmp(written, expected.c_str()) != 0)
+            ;
+
+        HB_CLOGGER->info("Worker {} catched: {}", widx, written);
+    }
+
+    HARTEBEEST_CORE_HDL.destroy_endpoint();
+}
+
+int main() {
+
+    HARTEBEEST_CORE_HDL.init();
+    int node_id = HARTEBEEST_CORE_HDL.get_nid();
+
+    std::vector<std::thread> workers;
+    for (int widx = 0; widx < N_WORKERS; widx++)
+        workers.push_back(std::thread(worker, node_id, widx));
+
+    for (auto& w: workers)
+        w.join();
+
+    HB_CLOGGER->info("Test end.");
+
+    return 0;
+}